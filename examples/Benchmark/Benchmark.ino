@@ -0,0 +1,436 @@
+/**
+ * Microbenchmarks for the SpektrumSatellite codec, the Scaler and the CSV
+ * serialization. We measure all supported value types (uint16_t, int, float
+ * and double) for 1024 and 2048 systems and print the result as JSON to
+ * Serial, so that the output can be stored and compared between releases:
+ *
+ * {"benchmarks":[
+ *   {"name":"parseFrame","type":"uint16_t","system":1024,"ops":..,
+ *    "ns_per_op":..,"ops_per_s":..,"allocations":..,"heap_delta":..,
+ *    "check":..},
+ *   ...
+ * ]}
+ *
+ * The input frames are generated with a fixed seed, so each run processes
+ * exactly the same data: we use clean frames, corrupt frames (flipped bits)
+ * and resync-heavy streams (garbage bytes in front of each frame). The time
+ * is always measured for a whole batch of operations: the input is prepared
+ * before the measurement (the getFrame benchmarks include the copy into the
+ * SpektrumMemoryStream). An op is one frame, except for the Scaler where it
+ * is a single scale() or deScale() call. The check is derived from the
+ * decoded values, so it changes if the result changes.
+ * The getFrame/load benchmarks decode the streams of the SpektrumLoadGenerator
+ * with dropped bytes, bit flips and truncated frames (per 1000 frames): their
+ * check is the number of frames after which the channel values were wrong,
+ * which shows how fast the decoder resynchronizes.
+ * allocations is the number of malloc and new calls (host build only, see
+ * extras/SpektrumBenchmark) and heap_delta the change of the free heap
+ * (ESP32/ESP8266 only): both should always be 0 because the library does not
+ * allocate memory. Unsupported values are reported as null.
+ */
+
+#include "SpektrumSatellite.h"
+#include "SpektrumCSV.h"
+#include "SpektrumMemoryStream.h"
+#include "SpektrumBulkDecoder.h"
+#include "SpektrumSBUS.h"
+#include "SpektrumCPPM.h"
+#include "SpektrumLoadGenerator.h"
+#include "Scaler.h"
+
+#ifdef __AVR__
+#define BENCH_FRAMES 8
+#define BENCH_REPEAT 10
+#else
+#define BENCH_FRAMES 256
+#define BENCH_REPEAT 50
+#endif
+#define BENCH_SEED 0x5eed1234UL
+#define BENCH_MAX_GARBAGE 15
+
+// generated input
+uint8_t frames[BENCH_FRAMES][SEND_BUFFER_SIZE];
+uint8_t inputs[BENCH_FRAMES][SEND_BUFFER_SIZE + BENCH_MAX_GARBAGE];
+uint8_t inputSizes[BENCH_FRAMES];
+uint16_t inputEnds[BENCH_FRAMES];
+uint16_t decoded[BENCH_FRAMES][MAX_CHANNELS];
+uint8_t streamBuffer[SEND_BUFFER_SIZE + BENCH_MAX_GARBAGE];
+uint8_t csvBuffer[256];
+uint16_t columnChannels[MAX_CHANNELS][BENCH_FRAMES];
+uint16_t columnFades[BENCH_FRAMES];
+uint8_t columnSystem[BENCH_FRAMES];
+uint32_t randomState;
+bool isFirstResult = true;
+
+// deterministic on all platforms (unlike random())
+uint32_t nextRandom() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+// Combines the channel values into the check (FNV-1a)
+uint32_t checksum(uint32_t check, const uint16_t* values) {
+  for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+    check = (check ^ values[ch]) * 16777619UL;
+  }
+  return check;
+}
+
+// Defined conversion of a scaled value into the check: casting a negative
+// float to an unsigned type is undefined, so we use 1/1000 steps
+uint32_t checkValue(double value) {
+  return (uint32_t)(int32_t)lround(value * 1000);
+}
+
+// Memory state before a measurement
+struct BenchMemory {
+  long heap;
+  long allocations;
+};
+
+BenchMemory benchMemory() {
+  BenchMemory result = {-1, -1};
+#if defined(ESP32) || defined(ESP8266)
+  result.heap = ESP.getFreeHeap();
+#endif
+#ifdef BENCH_COUNT_ALLOCATIONS
+  result.allocations = benchAllocations;
+#endif
+  return result;
+}
+
+void printDelta(long before, long after) {
+  if (before < 0) {
+    Serial.print("null");
+  } else {
+    Serial.print(after - before);
+  }
+}
+
+void printResult(const char* name, const char* type, int system, long ops,
+                 unsigned long timeUs, BenchMemory& before, uint32_t check) {
+  BenchMemory after = benchMemory();
+  float nsPerOp = ops > 0 ? 1000.0f * timeUs / ops : 0;
+  Serial.print(isFirstResult ? "  " : " ,");
+  isFirstResult = false;
+  Serial.print("{\"name\":\"");
+  Serial.print(name);
+  Serial.print("\",\"type\":\"");
+  Serial.print(type);
+  Serial.print("\",\"system\":");
+  Serial.print(system);
+  Serial.print(",\"ops\":");
+  Serial.print(ops);
+  Serial.print(",\"ns_per_op\":");
+  Serial.print(nsPerOp, 1);
+  Serial.print(",\"ops_per_s\":");
+  Serial.print(nsPerOp > 0 ? 1000000000.0f / nsPerOp : 0, 0);
+  Serial.print(",\"allocations\":");
+  printDelta(before.allocations, after.allocations);
+  Serial.print(",\"heap_delta\":");
+  printDelta(before.heap, after.heap);
+  Serial.print(",\"check\":");
+  Serial.print(check);
+  Serial.println("}");
+}
+
+/// Generates BENCH_FRAMES valid frames (alternating main and aux) for the
+/// indicated system
+void generateFrames(System system) {
+  SpektrumSatellite<uint16_t> sender(Serial);
+  sender.setBindingMode(Internal_DSMx_11ms);
+  sender.setSystem(system);
+  uint16_t maxValue = system == DSM2_22MS_1024 ? 1024 : 2048;
+  randomState = BENCH_SEED;
+  for (int f = 0; f < BENCH_FRAMES; f++) {
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      sender.setChannelValue((Channel)ch, nextRandom() % maxValue);
+    }
+    memcpy(frames[f], sender.getSendBuffer(f % 2 == 1), SEND_BUFFER_SIZE);
+  }
+}
+
+template <class T>
+void benchParseFrame(const char* type, System system, int bits) {
+  SpektrumSatellite<T> satellite(Serial);
+  satellite.setSystem(system);
+  uint32_t check = 0;
+  BenchMemory memory = benchMemory();
+  unsigned long start = micros();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+      satellite.parseFrame(frames[f]);
+      check += satellite.getChannelValuesRaw()[f % MAX_CHANNELS];
+    }
+  }
+  unsigned long time = micros() - start;
+  printResult("parseFrame", type, bits, (long)BENCH_REPEAT * BENCH_FRAMES,
+              time, memory, check);
+}
+
+template <class T>
+void benchGetSendBuffer(const char* type, System system, int bits) {
+  SpektrumSatellite<T> satellite(Serial);
+  satellite.setSystem(system);
+  satellite.parseFrame(frames[0]);
+  satellite.parseFrame(frames[1]);
+  uint32_t check = 0;
+  BenchMemory memory = benchMemory();
+  unsigned long start = micros();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+      Data* data = satellite.getSendBuffer(f % 2 == 1);
+      check += data->values[f % 7];
+    }
+  }
+  unsigned long time = micros() - start;
+  printResult("getSendBuffer", type, bits, (long)BENCH_REPEAT * BENCH_FRAMES,
+              time, memory, check);
+}
+
+template <class T>
+void benchScaler(const char* type, int bits, T outMin, T outMax) {
+  Scaler<T> scaler;
+  scaler.setValues(0, bits, outMin, outMax);
+  long ops = (long)BENCH_REPEAT * bits;
+  uint32_t check = 0;
+  BenchMemory memory = benchMemory();
+  unsigned long start = micros();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (int v = 0; v < bits; v++) {
+      check += checkValue(scaler.scale(v));
+    }
+  }
+  unsigned long time = micros() - start;
+  printResult("Scaler::scale", type, bits, ops, time, memory, check);
+
+  check = 0;
+  memory = benchMemory();
+  start = micros();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (int v = 0; v < bits; v++) {
+      check += checkValue(scaler.deScale(scaler.getOutMax() * v / bits));
+    }
+  }
+  time = micros() - start;
+  printResult("Scaler::deScale", type, bits, ops, time, memory, check);
+}
+
+template <class T>
+void benchCSV(const char* type, System system, int bits, T outMin, T outMax) {
+  SpektrumSatellite<T> satellite(Serial);
+  SpektrumCSV<T> csv;
+  satellite.setSystem(system);
+  satellite.setChannelValueRange(outMin, outMax);
+  int repeat = BENCH_REPEAT / 10 + 1;
+  uint32_t check = 0;
+  BenchMemory memory = benchMemory();
+  unsigned long start = micros();
+  for (int r = 0; r < repeat; r++) {
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+      satellite.parseFrame(frames[f]);
+      csv.toString(satellite, csvBuffer, sizeof(csvBuffer));
+      check += csvBuffer[f % 16];
+    }
+  }
+  unsigned long time = micros() - start;
+  printResult("SpektrumCSV::toString", type, bits,
+              (long)repeat * BENCH_FRAMES, time, memory, check);
+
+  check = 0;
+  memory = benchMemory();
+  start = micros();
+  for (int r = 0; r < repeat * BENCH_FRAMES; r++) {
+    csv.parse(csvBuffer, satellite);
+    check += satellite.getChannelValuesRaw()[r % MAX_CHANNELS];
+  }
+  time = micros() - start;
+  printResult("SpektrumCSV::parse", type, bits, (long)repeat * BENCH_FRAMES,
+              time, memory, check);
+}
+
+/// Measures getFrame() on clean, corrupt (bit flips) and resync-heavy
+/// (garbage before each frame) input
+template <class T>
+void benchGetFrame(const char* type, System system, int bits) {
+  const char* names[] = {"getFrame/clean", "getFrame/corrupt",
+                         "getFrame/resync"};
+  SpektrumMemoryStream stream(streamBuffer, sizeof(streamBuffer));
+  for (int mode = 0; mode < 3; mode++) {
+    SpektrumSatellite<T> satellite(stream);
+    satellite.setSystem(system);
+    randomState = BENCH_SEED + mode;
+    uint32_t check = 0;
+    unsigned long time = 0;
+    BenchMemory memory = benchMemory();
+    for (int r = 0; r < BENCH_REPEAT; r++) {
+      // prepare the input of the batch
+      for (int f = 0; f < BENCH_FRAMES; f++) {
+        size_t garbage = mode == 2 ? nextRandom() % (BENCH_MAX_GARBAGE + 1) : 0;
+        uint8_t* input = inputs[f];
+        for (size_t j = 0; j < garbage; j++) input[j] = nextRandom();
+        memcpy(input + garbage, frames[f], SEND_BUFFER_SIZE);
+        if (mode == 1 && nextRandom() % 4 == 0) {
+          // flip a bit in the header or in one of the channel values
+          input[garbage + nextRandom() % SEND_BUFFER_SIZE] ^=
+              1 << (nextRandom() % 8);
+        }
+        inputSizes[f] = garbage + SEND_BUFFER_SIZE;
+      }
+
+      unsigned long start = micros();
+      for (int f = 0; f < BENCH_FRAMES; f++) {
+        stream.setData(inputs[f], inputSizes[f]);
+        satellite.getFrame();
+        memcpy(decoded[f], satellite.getChannelValuesRaw(),
+               sizeof(decoded[f]));
+      }
+      time += micros() - start;
+      for (int f = 0; f < BENCH_FRAMES; f++) {
+        check = checksum(check, decoded[f]);
+      }
+    }
+    printResult(names[mode], type, bits, (long)BENCH_REPEAT * BENCH_FRAMES,
+                time, memory, check);
+  }
+}
+
+void benchBulkDecoder(System system, int bits) {
+  SpektrumBulkDecoder decoder(system);
+  SpektrumColumns columns;
+  for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+    columns.channels[ch] = columnChannels[ch];
+  }
+  columns.fades = columnFades;
+  columns.system = columnSystem;
+  uint32_t check = 0;
+  BenchMemory memory = benchMemory();
+  unsigned long start = micros();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    decoder.decode((uint8_t*)frames, BENCH_FRAMES, columns);
+    check += columnChannels[r % MAX_CHANNELS][r % BENCH_FRAMES];
+  }
+  unsigned long time = micros() - start;
+  printResult("SpektrumBulkDecoder", decoder.getImplementation(), bits,
+              (long)BENCH_REPEAT * BENCH_FRAMES, time, memory, check);
+}
+
+void benchEncoders(System system, int bits) {
+  SpektrumSatellite<uint16_t> satellite(Serial);
+  satellite.setSystem(system);
+  SpektrumSBUS sbus;
+  SpektrumCPPM cppm;
+  uint32_t check = 0;
+  BenchMemory memory = benchMemory();
+  unsigned long start = micros();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+      satellite.parseFrame(frames[f]);
+      check += sbus.encode(satellite)[f % SBUS_FRAME_SIZE];
+    }
+  }
+  unsigned long time = micros() - start;
+  printResult("SpektrumSBUS::encode", "uint16_t", bits,
+              (long)BENCH_REPEAT * BENCH_FRAMES, time, memory, check);
+
+  check = 0;
+  memory = benchMemory();
+  start = micros();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+      satellite.parseFrame(frames[f]);
+      check += cppm.encode(satellite)[f % cppm.size()];
+    }
+  }
+  time = micros() - start;
+  printResult("SpektrumCPPM::encode", "uint16_t", bits,
+              (long)BENCH_REPEAT * BENCH_FRAMES, time, memory, check);
+}
+
+/// Measures getFrame() on the generated streams with increasing fault rates
+void benchLoad(System system, int bits) {
+  const char* names[] = {"getFrame/load0", "getFrame/load10",
+                         "getFrame/load50"};
+  const uint16_t rates[] = {0, 10, 50};
+  SpektrumMemoryStream stream(streamBuffer, sizeof(streamBuffer));
+  for (int mode = 0; mode < 3; mode++) {
+    SpektrumLoadGenerator generator(BENCH_SEED);
+    generator.setSystem(system);
+    generator.setAuxInterleave(1);
+    generator.setFaults(rates[mode], rates[mode], rates[mode]);
+    SpektrumSatellite<uint16_t> satellite(stream);
+    satellite.setSystem(system);
+    uint16_t expected[MAX_CHANNELS];
+    uint32_t check = 0;
+    unsigned long time = 0;
+    BenchMemory memory = benchMemory();
+    uint32_t frameNumber = 0;
+    // the frames of a batch are stored one after the other: incomplete
+    // frames are combined with the next frame like in a real stream
+    uint8_t* batch = (uint8_t*)inputs;
+    size_t unread = 0;
+    for (int r = 0; r < BENCH_REPEAT; r++) {
+      size_t end = unread;
+      for (int f = 0; f < BENCH_FRAMES; f++) {
+        end += generator.next(batch + end);
+        inputEnds[f] = end;
+      }
+
+      unsigned long start = micros();
+      size_t pos = 0;
+      for (int f = 0; f < BENCH_FRAMES; f++) {
+        stream.setData(batch + pos, inputEnds[f] - pos);
+        satellite.getFrame();
+        pos = inputEnds[f] - stream.available();
+        memcpy(decoded[f], satellite.getChannelValuesRaw(),
+               sizeof(decoded[f]));
+      }
+      time += micros() - start;
+      unread = end - pos;
+      memmove(batch, batch + pos, unread);
+      for (int f = 0; f < BENCH_FRAMES; f++, frameNumber++) {
+        generator.getExpectedValues(0, frameNumber, expected);
+        if (memcmp(expected, decoded[f], sizeof(expected)) != 0) check++;
+      }
+    }
+    printResult(names[mode], "uint16_t", bits,
+                (long)BENCH_REPEAT * BENCH_FRAMES, time, memory, check);
+  }
+}
+
+template <class T>
+void benchType(const char* type, T outMin, T outMax) {
+  System systems[] = {DSM2_22MS_1024, DSMX_11MS_2048};
+  for (System system : systems) {
+    int bits = system == DSM2_22MS_1024 ? 1024 : 2048;
+    generateFrames(system);
+    benchParseFrame<T>(type, system, bits);
+    benchGetSendBuffer<T>(type, system, bits);
+    benchScaler<T>(type, bits, outMin, outMax);
+    benchCSV<T>(type, system, bits, outMin, outMax);
+    benchGetFrame<T>(type, system, bits);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println();
+  Serial.println("{\"benchmarks\":[");
+  benchType<uint16_t>("uint16_t", 0, 180);
+  benchType<int>("int", -500, 500);
+  benchType<float>("float", -1.0f, 1.0f);
+  benchType<double>("double", -1.0, 1.0);
+  generateFrames(DSM2_22MS_1024);
+  benchBulkDecoder(DSM2_22MS_1024, 1024);
+  benchEncoders(DSM2_22MS_1024, 1024);
+  benchLoad(DSM2_22MS_1024, 1024);
+  generateFrames(DSMX_11MS_2048);
+  benchBulkDecoder(DSMX_11MS_2048, 2048);
+  benchEncoders(DSMX_11MS_2048, 2048);
+  benchLoad(DSMX_11MS_2048, 2048);
+  Serial.println("]}");
+}
+
+void loop() {}
@@ -8,6 +8,8 @@
  *  The receiver is set into bind mode if it receives a defined number of falling signals right
  *  after the power up:  This is the reason why we need to power the receiver via a GPIO pin!
  * 
+ *  The binding does not block: we call pollBinding() in the loop and blink the LED quickly
+ *  until it has completed.
  */
 
 
@@ -42,19 +44,27 @@ void setup() {
 
   // we set the receiver into binding mode
   satellite.setBindingMode(External_DSM2_11ms);
-  satellite.startBinding(powerPin, rxPin);
+  satellite.beginBinding(powerPin, rxPin);
  
-  // start blinking
-  led_interval = 1000;
-
-  // switch rxPin to receive data on Serial 
-  Serial2.begin(SPEKTRUM_SATELLITE_BPS);
-
+  // blink quickly while binding
+  led_interval = 100;
 }
 
 void loop() {
-  // when we receive data we 
-  if (satellite.getFrame()) {  
+  // continue with the binding
+  if (satellite.getBindingState() == BindingFailed) {
+    // the pulses could not be sent in time: we start again
+    Serial.println("binding failed");
+    satellite.beginBinding(powerPin, rxPin);
+  } else if (satellite.getBindingState() != BindingDone) {
+    if (satellite.pollBinding() &&
+        satellite.getBindingState() == BindingDone) {
+      // switch rxPin to receive data on Serial 
+      Serial2.begin(SPEKTRUM_SATELLITE_BPS);
+      led_interval = 1000;
+    }
+  } else if (satellite.getFrame()) {  
+    // when we receive data we stop blinking
      led_interval = 0;
      led_state = false;
 
@@ -0,0 +1,86 @@
+/**
+ * Prints the RAM footprint (sizeof) of the SpektrumSatellite for the different
+ * SpektrumOptions. The compiler checks that each option really removes data
+ * and that the optional features only add data when they are requested: if
+ * one of the static_asserts fails the sketch does not compile.
+ *
+ * The flash size of a configuration is reported by the Arduino IDE when
+ * compiling a sketch which uses it: the unused features are not linked.
+ */
+
+#include "SpektrumSatellite.h"
+#include "SpektrumMemoryStream.h"
+
+typedef SpektrumSatellite<uint16_t> Default;
+typedef SpektrumSatellite<uint16_t, SpektrumReceiveOnly> ReceiveOnly;
+typedef SpektrumSatellite<uint16_t, SpektrumSendOnly> SendOnly;
+typedef SpektrumSatellite<uint16_t, SpektrumNoScaler> NoScaler;
+typedef SpektrumSatellite<uint16_t, SpektrumNoStats> NoStats;
+typedef SpektrumSatellite<uint16_t, SpektrumNoLog> NoLog;
+typedef SpektrumSatellite<uint16_t, SpektrumReceiveOnly | SpektrumNoScaler |
+                                        SpektrumNoStats | SpektrumNoLog>
+    MinimalReceiver;
+typedef SpektrumSatellite<uint16_t, SpektrumSendOnly | SpektrumNoScaler |
+                                        SpektrumNoStats | SpektrumNoLog>
+    MinimalSender;
+typedef SpektrumSatellite<uint16_t, SpektrumWithChannelMap> WithChannelMap;
+typedef SpektrumSatellite<uint16_t, SpektrumWithFailsafe> WithFailsafe;
+typedef SpektrumSatellite<uint16_t, SpektrumWithCallbacks> WithCallbacks;
+typedef SpektrumSatellite<uint16_t, SpektrumWithSnapshot> WithSnapshot;
+typedef SpektrumSatellite<uint16_t, SpektrumAll> All;
+
+static_assert(sizeof(ReceiveOnly) < sizeof(Default), "ReceiveOnly");
+static_assert(sizeof(SendOnly) < sizeof(Default), "SendOnly");
+static_assert(sizeof(NoScaler) < sizeof(Default), "NoScaler");
+static_assert(sizeof(NoStats) < sizeof(Default), "NoStats");
+static_assert(sizeof(NoLog) < sizeof(Default), "NoLog");
+static_assert(sizeof(MinimalReceiver) < sizeof(ReceiveOnly), "MinimalReceiver");
+static_assert(sizeof(MinimalSender) < sizeof(SendOnly), "MinimalSender");
+// the optional features only add data when they are requested
+static_assert(sizeof(WithChannelMap) > sizeof(Default), "WithChannelMap");
+static_assert(sizeof(WithFailsafe) > sizeof(Default), "WithFailsafe");
+static_assert(sizeof(WithCallbacks) > sizeof(Default), "WithCallbacks");
+static_assert(sizeof(WithSnapshot) > sizeof(Default), "WithSnapshot");
+
+// use the remaining features so that they are compiled
+uint8_t buffer[2 * SEND_BUFFER_SIZE];
+SpektrumMemoryStream stream(buffer, sizeof(buffer));
+ReceiveOnly receiver(stream);
+MinimalReceiver minimalReceiver(stream);
+SendOnly sender(stream);
+MinimalSender minimalSender(stream);
+
+void printSize(const char* name, size_t size) {
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.println(size);
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println();
+  printSize("SpektrumDefault", sizeof(Default));
+  printSize("SpektrumReceiveOnly", sizeof(ReceiveOnly));
+  printSize("SpektrumSendOnly", sizeof(SendOnly));
+  printSize("SpektrumNoScaler", sizeof(NoScaler));
+  printSize("SpektrumNoStats", sizeof(NoStats));
+  printSize("SpektrumNoLog", sizeof(NoLog));
+  printSize("Minimal receiver", sizeof(MinimalReceiver));
+  printSize("Minimal sender", sizeof(MinimalSender));
+  printSize("SpektrumWithChannelMap", sizeof(WithChannelMap));
+  printSize("SpektrumWithFailsafe", sizeof(WithFailsafe));
+  printSize("SpektrumWithCallbacks", sizeof(WithCallbacks));
+  printSize("SpektrumWithSnapshot", sizeof(WithSnapshot));
+  printSize("SpektrumAll", sizeof(All));
+
+  receiver.getFrame();
+  minimalReceiver.getFrame();
+  minimalReceiver.getChannelValue(Throttle);
+  sender.setThrottle(100);
+  sender.sendData();
+  stream.clear();
+  minimalSender.setThrottle(100);
+  minimalSender.sendData();
+}
+
+void loop() {}
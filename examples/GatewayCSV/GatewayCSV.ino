@@ -5,6 +5,8 @@
  * the data to Flightgear: Flighger expects float values berween -1.0 and 1.0. Therefore we use
  * define SpektrumSatellite<float>  and set the range with satellite.setChannelValueRange(-1.0f, 1.0f);
  * 
+ * The frames are forwarded in the onFrame callback as soon as they have been decoded.
+ * 
  * This demo supports an ESP32 or ESP8266
  */
 
@@ -32,10 +34,23 @@ unsigned long intervall = 1000;            // send every 500ms (=2 messages per
 unsigned long intervallTime;
 uint8_t* buffer = new uint8_t[10*MAX_CHANNELS+1];
 
-SpektrumSatellite<float> satellite(Serial2); // we use doubles!
+SpektrumSatellite<float, SpektrumWithCallbacks> satellite(Serial2); // we use doubles!
 SpektrumCSV<float> csv(',',true);
 WiFiUDP udp;
 
+// send CSV via UDP
+void sendFrame(SpektrumSatellite<float, SpektrumWithCallbacks>& satellite,
+               void* ref) {
+  if (millis()>intervallTime) {
+    intervallTime = millis()+intervall;
+    csv.toString(satellite, buffer, 10*MAX_CHANNELS+1);
+    int len = strlen((char*)buffer);
+
+    udp.beginPacket(udpAddress, udpPort);
+    udp.write(buffer, len);
+    udp.endPacket();
+  }
+}
 
 void setup() {
   Serial2.begin(SPEKTRUM_SATELLITE_BPS);
@@ -58,19 +73,10 @@ void setup() {
   //scale the values from 0 to -1.0 to 1.0
   satellite.setChannelValueRange(-1.0f, 1.0f);
 
+  // forward the decoded frames
+  satellite.onFrame(sendFrame);
 }
 
 void loop() {
-
-  if (millis()>intervallTime) {
-    if (satellite.getFrame()) {   
-      // send CSV via UDP
-      csv.toString(satellite, buffer, sizeof(buffer));
-      int len = strlen((char*)buffer);
-
-      udp.beginPacket(udpAddress, udpPort);
-      udp.write(buffer, len);
-      udp.endPacket();
-    } 
-  }
+  satellite.getFrame();
 }
\ No newline at end of file
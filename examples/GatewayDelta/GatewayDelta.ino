@@ -0,0 +1,78 @@
+/**
+ * Example Use of the SpektrumSatellite to receive the data on the RX line and send only the
+ * changed channels via UDP.
+ * 
+ * Most of the time most sticks do not move: the SpektrumDeltaPublisher only sends the channels
+ * which have changed by more than the hysteresis and every 50 frames a keyframe with all channels.
+ * The receiver can apply the packets with the SpektrumDeltaReceiver:
+ * 
+ *   if (udp.parsePacket() > 0) {
+ *     int len = udp.read(packet, DELTA_MAX_PACKET_SIZE);
+ *     deltaReceiver.apply(packet, len, satellite);
+ *   }
+ * 
+ * This demo supports an ESP32 or ESP8266
+ */
+
+#include "SpektrumSatellite.h"
+#include "SpektrumDelta.h"
+
+#ifdef ESP32
+  #include <WiFi.h>
+  #include <WiFiUdp.h>
+#else
+#ifdef ESP8266
+  #include <ESP8266WiFi.h>
+  #include <WiFiUdp.h>
+#else
+    #error "This demo requires an ESP32 or ESP8266 -> Please convert the sketch to your board"
+#endif
+#endif
+
+
+char* ssid = "SSID";                      //Change this to your router SSID.
+char* password =  "password";             //Change this to your router password.
+const char * udpAddress = "192.168.1.255"; //Change this to match your network
+const int udpPort = 6789;                 //Change this if you need another port 
+
+SpektrumSatellite<uint16_t, SpektrumWithCallbacks> satellite(Serial2); 
+SpektrumDeltaPublisher publisher;
+WiFiUDP udp;
+
+// send the changed channels via UDP
+void sendFrame(SpektrumSatellite<uint16_t, SpektrumWithCallbacks>& satellite,
+               void* ref) {
+  int len = publisher.encode(satellite);
+  if (len > 0) {
+    udp.beginPacket(udpAddress, udpPort);
+    udp.write(publisher.getPacket(), len);
+    udp.endPacket();
+  }
+}
+
+void setup() {
+  Serial2.begin(SPEKTRUM_SATELLITE_BPS);
+  
+  Serial.begin(115200);
+  Serial.println();
+  Serial.println("setup");
+  satellite.setLog(Serial);
+  satellite.setLogMod(0); // do not log records
+
+  //Initiate WIFI connection
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) {
+    Serial.print('.');
+    delay(500);
+  }
+
+  // ignore the noise of the sticks (in raw units)
+  publisher.setHysteresis(2);
+
+  // forward the decoded frames
+  satellite.onFrame(sendFrame);
+}
+
+void loop() {
+  satellite.getFrame();
+}
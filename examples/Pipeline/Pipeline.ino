@@ -0,0 +1,52 @@
+/**
+ * Example Use of the SpektrumPipeline: we receive the data on Serial2, smooth the throttle,
+ * mix the elevons, forward the result as SBUS on Serial1 and log it as CSV.
+ * 
+ * The stages are combined at compile time and process the same frame object. Because
+ * SPEKTRUM_PROFILE is defined we can print the time which is spent in each stage.
+ * 
+ * Please check and adapt the pin assignments for your Microcontroller.
+ * This demo needs Serial1 and Serial2 and supports an ESP32 or a Mega 2560.
+ */
+
+#if !defined(ESP32) && !defined(ARDUINO_AVR_MEGA2560)
+  #error "This demo requires Serial1 (8E2) and Serial2 -> Please convert the sketch to your board"
+#endif
+
+#define SPEKTRUM_PROFILE
+#include "SpektrumSatellite.h"
+#include "SpektrumPipeline.h"
+
+SpektrumSatellite<uint16_t> satellite(Serial2); 
+SpektrumLowPassFilter filter(2, 1 << Throttle);
+SpektrumMixer mixer;
+SpektrumSBUSSink sbus(Serial1);
+SpektrumCSVSink csv(Serial);
+auto pipeline = spektrumPipeline(satellite, filter, mixer, sbus, csv);
+unsigned long reportTime;
+
+void setup() {
+  Serial2.begin(SPEKTRUM_SATELLITE_BPS);
+  // SBUS: 100000 bps, 8E2 (the signal needs to be inverted)
+  Serial1.begin(SBUS_BPS, SERIAL_8E2);
+
+  Serial.begin(115200);
+  Serial.println();
+  Serial.println("setup");
+
+  // elevons
+  mixer.addRule(Aileron, Aileron, 50);
+  mixer.addRule(Aileron, Elevator, 50);
+  mixer.addRule(Elevator, Aileron, -50);
+  mixer.addRule(Elevator, Elevator, 50);
+}
+
+void loop() {
+  pipeline.process();
+
+  // report the processing time per stage every 10 seconds
+  if (millis() > reportTime) {
+    reportTime = millis() + 10000;
+    pipeline.printTo(Serial);
+  }
+}
@@ -3,9 +3,26 @@
  * Test cases for the  SpektrumSatellite class
  */
 
+// we also test the profiler of the satellite and of the pipeline
+#define SPEKTRUM_PROFILE
 #include "SpektrumSatellite.h"
 #include "SpektrumCSV.h"
+#include "SpektrumMemoryStream.h"
+#include "SpektrumBulkDecoder.h"
+#include "SpektrumSBUS.h"
+#include "SpektrumCPPM.h"
+#include "SpektrumSharedMemory.h"
+#include "SpektrumDelta.h"
+#include "SpektrumPipeline.h"
+#include "SpektrumLoadGenerator.h"
 #include "Scaler.h"
+#if defined(ESP32) || !defined(ARDUINO)
+#include <thread>
+#define TEST_THREADS
+#endif
+#if defined(SPEKTRUM_SHARED_MEMORY) && !defined(ARDUINO)
+#include <sys/wait.h>
+#endif
 
 void testScaling() {
   Serial.println("***********************");
@@ -180,6 +197,940 @@ void testHeader() {
 
 }
 
+// virtual clock and pin log of the binding: the clock advances by 1us per
+// call, so that the busy wait of the pulses terminates
+unsigned long bindingClockUs = 0;
+unsigned long bindingClock() { return bindingClockUs++; }
+struct BindingEdge {
+  unsigned pin;
+  bool high;
+  unsigned long time;
+};
+BindingEdge bindingEdges[64];
+int bindingEdgeCount = 0;
+void bindingPinWrite(unsigned pin, bool high, void* ref) {
+  if (bindingEdgeCount < 64) {
+    bindingEdges[bindingEdgeCount++] = {pin, high, bindingClockUs};
+  }
+}
+
+// Polls the binding with the indicated steps of the virtual clock: returns
+// false if the states are not processed in order
+bool runBinding(SpektrumSatellite<uint16_t>& satellite, unsigned long stepUs) {
+  bool ordered = true;
+  BindingState last = satellite.getBindingState();
+  for (long j = 0; j < 1000000 && !satellite.pollBinding(); j++) {
+    BindingState state = satellite.getBindingState();
+    if (state < last) ordered = false;
+    last = state;
+    bindingClockUs += stepUs;
+  }
+  return ordered;
+}
+
+// Number of edges of the pin with the indicated level
+int countBindingEdges(unsigned pin, bool high) {
+  int result = 0;
+  for (int j = 0; j < bindingEdgeCount; j++) {
+    if (bindingEdges[j].pin == pin && bindingEdges[j].high == high) result++;
+  }
+  return result;
+}
+
+void testBinding() {
+  Serial.println("***********************");
+  Serial.println("testBinding ");
+  const unsigned powerPin = 23, rxPin = 16;
+  SpektrumSatellite<uint16_t> satellite(Serial);
+  satellite.setBindingMode(External_DSM2_11ms);
+  satellite.setBindingIO(bindingClock, bindingPinWrite);
+
+  bindingClockUs = 1000;
+  bindingEdgeCount = 0;
+  satellite.beginBinding(powerPin, rxPin);
+  Serial.print("state ->");
+  Serial.println(satellite.getBindingState()==BindingPowerOff?"OK":"Error");
+  bool ordered = runBinding(satellite, 10);
+  unsigned long time = bindingClockUs - 1000;
+  Serial.print("ordered ->");
+  Serial.println(ordered?"OK":"Error");
+  Serial.print("state ->");
+  Serial.println(satellite.getBindingState()==BindingDone?"OK":"Error");
+  Serial.print("progress ->");
+  Serial.println(satellite.getBindingProgress()==100?"OK":"Error");
+  Serial.print("time ->");
+  Serial.println(time >= 1000UL * (BINDING_POWER_OFF_MS + BINDING_POWER_ON_MS +
+                                   BINDING_SETTLE_MS)?"OK":"Error");
+
+  // power off, power on and one falling and rising edge per pulse
+  Serial.print("pulses ->");
+  Serial.println(countBindingEdges(powerPin, true)==1 &&
+                 countBindingEdges(rxPin, false)==External_DSM2_11ms &&
+                 countBindingEdges(rxPin, true)==External_DSM2_11ms + 1
+                 ?"OK":"Error");
+  // the first pulse is sent in the call which sees the end of the power on
+  // time, all pulses are 100us wide
+  unsigned long powerOn = 0, firstPulse = 0, last = 0;
+  bool isWidthOK = true;
+  for (int j = 0; j < bindingEdgeCount; j++) {
+    BindingEdge& edge = bindingEdges[j];
+    if (edge.pin == powerPin && edge.high) powerOn = edge.time;
+    if (edge.pin != rxPin || powerOn == 0) continue;
+    if (firstPulse == 0) firstPulse = edge.time;
+    else if (edge.time - last != BINDING_PULSE_US) isWidthOK = false;
+    last = edge.time;
+  }
+  // the polls are 10us (plus the clock reads) apart
+  unsigned long powerOff = 1000 + 1000UL * BINDING_POWER_OFF_MS;
+  Serial.print("power on ->");
+  Serial.println(powerOn > powerOff && powerOn - powerOff < 20?"OK":"Error");
+  Serial.print("first pulse ->");
+  Serial.println(firstPulse - powerOn > 1000UL * BINDING_POWER_ON_MS &&
+                 firstPulse - powerOn < 1000UL * BINDING_POWER_ON_MS + 20
+                 ?"OK":"Error");
+  Serial.print("width ->");
+  Serial.println(isWidthOK?"OK":"Error");
+  Serial.print("window ->");
+  Serial.println(last - powerOn <= 1000UL * BINDING_WINDOW_MS?"OK":"Error");
+  // the burst does not depend on the polls: at most 2ms
+  Serial.print("burst ->");
+  Serial.println(last - firstPulse==(2UL * External_DSM2_11ms - 1) *
+                                        BINDING_PULSE_US &&
+                 last - firstPulse <= 2000?"OK":"Error");
+
+  // a late poll misses the window: the receiver is power cycled
+  bindingEdgeCount = 0;
+  satellite.beginBinding(powerPin, rxPin);
+  while (satellite.getBindingState() != BindingPowerOn) {
+    bindingClockUs += 1000;
+    satellite.pollBinding();
+  }
+  bindingClockUs += 1000UL * (BINDING_WINDOW_MS + 1);
+  satellite.pollBinding();
+  Serial.print("retry ->");
+  Serial.println(satellite.getBindingState()==BindingPowerOff &&
+                 countBindingEdges(powerPin, false)==2 &&
+                 countBindingEdges(rxPin, false)==0?"OK":"Error");
+  runBinding(satellite, 10);
+  Serial.print("retry done ->");
+  Serial.println(satellite.getBindingState()==BindingDone &&
+                 countBindingEdges(rxPin, false)==External_DSM2_11ms
+                 ?"OK":"Error");
+
+  // we give up if the window is always missed
+  bindingEdgeCount = 0;
+  satellite.beginBinding(powerPin, rxPin);
+  runBinding(satellite, 1000UL * (BINDING_WINDOW_MS + 50));
+  Serial.print("failed ->");
+  Serial.println(satellite.getBindingState()==BindingFailed &&
+                 satellite.pollBinding() &&
+                 countBindingEdges(powerPin, true)==BINDING_MAX_RETRIES + 1 &&
+                 countBindingEdges(rxPin, false)==0?"OK":"Error");
+}
+typedef SpektrumSatellite<uint16_t, SpektrumWithCallbacks> CallbackSatellite;
+int frameCallbackCount = 0;
+void frameCallback(CallbackSatellite& satellite, void* ref) {
+  frameCallbackCount++;
+}
+
+void testCallbacks() {
+  Serial.println("***********************");
+  Serial.println("testCallbacks ");
+  uint8_t buffer[SEND_BUFFER_SIZE];
+  SpektrumMemoryStream stream(buffer, sizeof(buffer));
+  CallbackSatellite satellite(stream);
+
+  // the callback can read a snapshot
+  System detected = DSM2_22MS_1024;
+  SpektrumSnapshot snapshot;
+  auto systemCallback = [&](System system) {
+    detected = system;
+    satellite.readSnapshot(snapshot);
+  };
+  int lostCount = 0;
+  auto lostCallback = [&lostCount](CallbackSatellite& s) { lostCount++; };
+  satellite.onFrame(frameCallback);
+  satellite.onSystemDetected(systemCallback);
+  satellite.onConnectionLost(lostCallback);
+
+  // send a frame to ourself
+  satellite.sendData();
+  satellite.getFrame();
+  Serial.print("onFrame ->");
+  Serial.println(frameCallbackCount==1?"OK":"Error");
+  Serial.print("onSystemDetected ->");
+  Serial.println(detected==DSMX_11MS_2048?"OK":"Error");
+
+  // no data for more than 3 frame periods
+  delay(3 * satellite.getFramePeriod() + 1);
+  satellite.getFrame();
+  satellite.getFrame();
+  Serial.print("onConnectionLost ->");
+  Serial.println(lostCount==1?"OK":"Error");
+}
+void testFailsafe() {
+  Serial.println("***********************");
+  Serial.println("testFailsafe ");
+  uint8_t buffer[SEND_BUFFER_SIZE];
+  SpektrumMemoryStream stream(buffer, sizeof(buffer));
+  SpektrumSatellite<uint16_t, SpektrumWithFailsafe> satellite(stream);
+  satellite.setChannelValueRange(0, 180);
+  satellite.setFailsafeValue(Throttle, 0);
+  satellite.setThrottle(180);
+  satellite.setAileron(90);
+
+  satellite.sendData();
+  satellite.getFrame();
+  Serial.print("getFramePeriod ->");
+  Serial.println(satellite.getFramePeriod()==11?"OK":"Error");
+
+  // no failsafe after 2 missed frames
+  delay(2 * 11);
+  satellite.getFrame();
+  Serial.print("isFailsafe ->");
+  Serial.println(!satellite.isFailsafe() && !satellite.isLinkStale()
+                 ?"OK":"Error");
+
+  // failsafe after 3 missed frames: isLinkStale() agrees, while
+  // isConnected() still uses TRANSACTION_TIME
+  delay(11 + 1);
+  Serial.print("isLinkStale ->");
+  Serial.println(satellite.isLinkStale() && satellite.isConnected()
+                 ?"OK":"Error");
+  satellite.getFrame();
+  Serial.print("isFailsafe ->");
+  Serial.println(satellite.isFailsafe() && satellite.isLinkStale()
+                 ?"OK":"Error");
+  Serial.print("preset ->");
+  Serial.println(satellite.getThrottle()==0?"OK":"Error");
+  Serial.print("hold ->");
+  Serial.println(satellite.getAileron()==90?"OK":"Error");
+
+  // 0 frames is handled like 1: a poll right after a frame is no failsafe
+  satellite.setFailsafeFrames(0);
+  stream.clear();
+  satellite.sendData();
+  satellite.getFrame();
+  // 0 is clamped to 1 frame: so we are still connected after half a period
+  delay(satellite.getFramePeriod() / 2);
+  satellite.getFrame();
+  Serial.print("0 frames ->");
+  Serial.println(!satellite.isFailsafe() && !satellite.isLinkStale()
+                 ?"OK":"Error");
+}
+// Checks that the histogram contains all measurements of the stage
+bool isHistogramComplete(ProfileStatistics& stat) {
+  uint32_t total = 0;
+  for (int b = 0; b < SPEKTRUM_PROFILE_BUCKETS; b++) total += stat.histogram[b];
+  return total == stat.count;
+}
+
+void testProfiler() {
+  Serial.println("***********************");
+  Serial.println("testProfiler ");
+  uint8_t buffer[SEND_BUFFER_SIZE];
+  SpektrumMemoryStream stream(buffer, sizeof(buffer));
+  SpektrumSatellite<uint16_t> sender(stream);
+  SpektrumSatellite<uint16_t> receiver(stream);
+  SpektrumProfiler& profiler = *receiver.getProfiler();
+
+  // 5 frames, 3 polls without data and 2 scaled values
+  const int frames = 5;
+  for (int j = 0; j < frames; j++) {
+    stream.clear();
+    sender.setThrottle(j * 100);
+    sender.sendData();
+    receiver.getFrame();
+  }
+  for (int j = 0; j < 3; j++) receiver.getFrame();
+  receiver.getThrottle();
+  receiver.getAileron();
+  Serial.print("counts ->");
+  Serial.println(profiler.getStatistics(StageAvailable).count==frames + 3 &&
+                 profiler.getStatistics(StageSkip).count==0 &&
+                 profiler.getStatistics(StageReadBytes).count==frames &&
+                 profiler.getStatistics(StageParseFrame).count==frames &&
+                 profiler.getStatistics(StageScale).count==2 &&
+                 sender.getProfiler()->getStatistics(StageSendBuffer).count
+                     ==frames &&
+                 sender.getProfiler()->getStatistics(StageWrite).count==frames
+                 ?"OK":"Error");
+  bool complete = true;
+  for (int j = 0; j < PROFILE_STAGE_COUNT; j++) {
+    complete = complete &&
+               isHistogramComplete(profiler.getStatistics((ProfileStage)j));
+  }
+  Serial.print("histogram ->");
+  Serial.println(complete?"OK":"Error");
+
+  // known durations: each bucket covers 4 times the range of the previous one
+  profiler.reset();
+  profiler.record(StageWrite, 0);
+  profiler.record(StageWrite, SpektrumProfiler::getBucketLimit(0) - 1);
+  profiler.record(StageWrite, SpektrumProfiler::getBucketLimit(0));
+  profiler.record(StageWrite, SpektrumProfiler::getBucketLimit(2));
+  profiler.record(StageWrite, UINT32_MAX);
+  ProfileStatistics& stat = profiler.getStatistics(StageWrite);
+  Serial.print("buckets ->");
+  Serial.println(stat.histogram[0]==2 && stat.histogram[1]==1 &&
+                 stat.histogram[2]==0 && stat.histogram[3]==1 &&
+                 stat.histogram[SPEKTRUM_PROFILE_BUCKETS - 1]==1 &&
+                 stat.count==5 && stat.min==0 && stat.max==UINT32_MAX &&
+                 profiler.getStatistics(StageParseFrame).count==0
+                 ?"OK":"Error");
+
+  // durations are measured without overflow across 32 bit ticks
+  ProfileTicks start = SpektrumProfiler::ticks();
+  delay(2);
+  uint32_t elapsed = SpektrumProfiler::elapsed(start);
+  Serial.print("elapsed ->");
+  Serial.println(elapsed > 0 && elapsed < UINT32_MAX?"OK":"Error");
+  Serial.print("saturated ->");
+  Serial.println(SpektrumProfiler::elapsed(SpektrumProfiler::ticks() -
+                                           (ProfileTicks)UINT32_MAX - 1)
+                     ==UINT32_MAX || sizeof(ProfileTicks)==4?"OK":"Error");
+}
+
+void testBulkDecoder() {
+  Serial.println("***********************");
+  Serial.println("testBulkDecoder ");
+  const int count = 9;
+  uint8_t frames[count][SEND_BUFFER_SIZE];
+  uint16_t channels[MAX_CHANNELS][count];
+  uint16_t fades[count];
+  uint8_t system[count];
+  SpektrumColumns columns;
+  for (int ch = 0; ch < MAX_CHANNELS; ch++) columns.channels[ch] = channels[ch];
+  columns.fades = fades;
+  columns.system = system;
+
+  // random frames (incl. invalid channel ids)
+  randomSeed(1);
+  for (int f = 0; f < count; f++) {
+    for (int b = 0; b < SEND_BUFFER_SIZE; b++) frames[f][b] = random(256);
+  }
+  frames[0][1] = DSM2_22MS_1024;
+
+  SpektrumSatellite<uint16_t> satellite(Serial);
+  SpektrumBulkDecoder decoder;
+  decoder.begin(satellite);
+  decoder.decode((uint8_t*)frames, count, columns);
+  Serial.print("implementation: ");
+  Serial.println(decoder.getImplementation());
+
+  bool ok = true;
+  for (int f = 0; f < count; f++) {
+    satellite.parseFrame(frames[f]);
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      if (channels[ch][f] != satellite.getChannelValuesRaw()[ch]) ok = false;
+    }
+    if (fades[f] != satellite.getFades()) ok = false;
+  }
+  Serial.print("decode ->");
+  Serial.println(ok?"OK":"Error");
+  Serial.print("system ->");
+  Serial.println(decoder.getSystem()==satellite.getSystem()?"OK":"Error");
+
+  // begin() takes over the byte order, the reversed channels and the system
+  // which has already been received: the new system byte is ignored
+  SpektrumSatellite<uint16_t, SpektrumWithChannelMap> swapped(Serial);
+  swapped.parseFrame(frames[0]);
+  swapped.switchEndianness();
+  swapped.setChannelReversed(Aileron, true);
+  frames[0][1] = DSMX_11MS_2048;
+  SpektrumBulkDecoder swappedDecoder;
+  swappedDecoder.begin(swapped);
+  swappedDecoder.decode((uint8_t*)frames, count, columns);
+  ok = true;
+  for (int f = 0; f < count; f++) {
+    swapped.parseFrame(frames[f]);
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      if (channels[ch][f] != swapped.getChannelValuesRaw()[ch]) ok = false;
+    }
+  }
+  Serial.print("begin ->");
+  Serial.println(ok && swapped.getSystem()==DSM2_22MS_1024 &&
+                 swappedDecoder.getSystem()==DSM2_22MS_1024?"OK":"Error");
+}
+void testSBUS() {
+  Serial.println("***********************");
+  Serial.println("testSBUS ");
+  uint16_t values[MAX_CHANNELS];
+  for (int j=0;j<MAX_CHANNELS;j++){
+      values[j] = (j * 171) % 2048;
+  }
+  const uint8_t expected[SBUS_FRAME_SIZE] = {
+      0x0f, 0x00, 0x58, 0x85, 0x55, 0x02, 0xc4, 0xaa, 0xab, 0x09, 0xb0, 0x95, 0x58,
+      0x1d, 0xb0, 0xab, 0xb3, 0x0e, 0x3e, 0xf0, 0x81, 0x0f, 0x7c, 0x08, 0x00};
+
+  // pass the values unchanged
+  SpektrumSBUS sbus(0, 2048);
+  uint8_t* frame = sbus.encode(values, true, SBUS_FLAG_FAILSAFE);
+  Serial.print("encode ->");
+  Serial.println(memcmp(frame, expected, SBUS_FRAME_SIZE)==0?"OK":"Error");
+
+  // default range
+  SpektrumSBUS sbusScaled;
+  values[Throttle] = 0;
+  values[Aileron] = 1024;
+  frame = sbusScaled.encode(values, true);
+  uint16_t throttle = frame[1] | (frame[2] & 0x07) << 8;
+  uint16_t aileron = (frame[2] >> 3) | (frame[3] & 0x3f) << 5;
+  Serial.print("min ->");
+  Serial.println(throttle==SBUS_MIN?"OK":"Error");
+  Serial.print("center ->");
+  Serial.println(aileron==SBUS_MIN + (SBUS_MAX - SBUS_MIN) / 2?"OK":"Error");
+
+  // only the channels 12-15 which Spektrum does not provide can be set
+  Serial.print("unused ->");
+  Serial.println(!sbusScaled.setUnusedValue(-1, 0) &&
+                 !sbusScaled.setUnusedValue(Aux7, 0) &&
+                 !sbusScaled.setUnusedValue(SBUS_CHANNELS, 0) &&
+                 sbusScaled.setUnusedValue(15, SBUS_MAX)?"OK":"Error");
+  frame = sbusScaled.encode(values, true);
+  uint16_t ch16 = (frame[21] >> 5) | frame[22] << 3;
+  Serial.print("ch16 ->");
+  Serial.println(ch16==SBUS_MAX?"OK":"Error");
+}
+
+void testCPPM() {
+  Serial.println("***********************");
+  Serial.println("testCPPM ");
+  uint16_t values[MAX_CHANNELS] = {0, 512, 1024, 1536, 0, 0, 0, 0, 0, 0, 0, 0};
+  SpektrumCPPM cppm(4);
+  uint16_t* schedule = cppm.encode(values, true);
+  const uint16_t expected[] = {1000, 1250, 1500, 1750, 22500 - 5500};
+  Serial.print("size ->");
+  Serial.println(cppm.size()==5?"OK":"Error");
+  Serial.print("encode ->");
+  Serial.println(memcmp(schedule, expected, sizeof(expected))==0?"OK":"Error");
+
+  // 12 channels at full travel do not fit into 22.5ms with the sync gap
+  for (int ch = 0; ch < MAX_CHANNELS; ch++) values[ch] = 2047;
+  SpektrumCPPM capped(12);
+  schedule = capped.encode(values, true);
+  long total = 0;
+  for (int j = 0; j < capped.size(); j++) total += schedule[j];
+  Serial.print("capped ->");
+  Serial.println(capped.getChannels()==9 &&
+                 schedule[9] >= CPPM_MIN_SYNC_US &&
+                 total==CPPM_FRAME_US?"OK":"Error");
+  SpektrumCPPM all(12, 27000);
+  schedule = all.encode(values, true);
+  Serial.print("27ms ->");
+  Serial.println(all.getChannels()==12 &&
+                 schedule[12] >= CPPM_MIN_SYNC_US?"OK":"Error");
+}
+
+void testChannelMap() {
+  Serial.println("***********************");
+  Serial.println("testChannelMap ");
+  uint8_t buffer[2 * SEND_BUFFER_SIZE];
+  SpektrumMemoryStream stream(buffer, sizeof(buffer));
+  SpektrumSatellite<uint16_t> sender(stream);
+  SpektrumSatellite<uint16_t, SpektrumWithChannelMap> receiver(stream);
+  for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+    sender.setChannelValueRaw((Channel)ch, 100 * (ch + 1));
+  }
+  receiver.setChannelMap(ChannelOrderAETR);
+  receiver.setChannelReversed(Rudder, true);
+  // the unused word of the aux frame is 0: so we send it first
+  Data frames[2];
+  memcpy(&frames[0], sender.getSendBuffer(true), SEND_BUFFER_SIZE);
+  memcpy(&frames[1], sender.getSendBuffer(false), SEND_BUFFER_SIZE);
+  receiver.parseFrame(&frames[0]);
+  receiver.parseFrame(&frames[1]);
+
+  uint16_t* values = receiver.getChannelValuesRaw();
+  Serial.print("order ->");
+  Serial.println(values[0]==200 && values[1]==300 && values[2]==100 &&
+                 values[4]==500 && values[11]==1200?"OK":"Error");
+  Serial.print("reversed ->");
+  Serial.println(values[3]==(2047 - 400)?"OK":"Error");
+  Serial.print("invalid ->");
+  const Channel twice[] = {Aileron, Aileron};
+  Serial.println(!receiver.setChannelMap(twice)?"OK":"Error");
+
+  // sending applies the inverse mapping
+  SpektrumSatellite<uint16_t> check(stream);
+  check.parseFrame(receiver.getSendBuffer(true));
+  check.parseFrame(receiver.getSendBuffer(false));
+  Serial.print("send ->");
+  Serial.println(memcmp(check.getChannelValuesRaw(),
+                        sender.getChannelValuesRaw(), 2 * MAX_CHANNELS)==0
+                 ?"OK":"Error");
+
+  // the bulk decoder takes over the mapping
+  SpektrumSatellite<uint16_t, SpektrumWithChannelMap> mapped(stream);
+  mapped.setChannelMap(ChannelOrderAETR);
+  mapped.setChannelReversed(Rudder, true);
+  SpektrumBulkDecoder decoder;
+  decoder.begin(mapped);
+  uint16_t channels[MAX_CHANNELS][2], fades[2];
+  uint8_t system[2];
+  SpektrumColumns columns;
+  for (int ch = 0; ch < MAX_CHANNELS; ch++) columns.channels[ch] = channels[ch];
+  columns.fades = fades;
+  columns.system = system;
+  decoder.decode((uint8_t*)frames, 2, columns);
+  bool ok = true;
+  for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+    ok = ok && channels[ch][1] == values[ch];
+  }
+  Serial.print("bulk ->");
+  Serial.println(ok?"OK":"Error");
+}
+
+void testDelta() {
+  Serial.println("***********************");
+  Serial.println("testDelta ");
+  uint8_t buffer[SEND_BUFFER_SIZE];
+  SpektrumMemoryStream stream(buffer, sizeof(buffer));
+  SpektrumSatellite<uint16_t> source(stream);
+  SpektrumSatellite<uint16_t> target(stream);
+  SpektrumDeltaPublisher publisher(50);
+  SpektrumDeltaReceiver receiver;
+  publisher.setHysteresis(2);
+
+  // the throttle moves slowly, the other sticks only show some noise
+  const int frames = 1000;
+  long deltaBytes = 0;
+  bool ok = true;
+  for (int j = 0; j < frames; j++) {
+    uint16_t* values = source.getChannelValuesRaw();
+    values[Throttle] = j / 4;
+    for (int ch = Aileron; ch < MAX_CHANNELS; ch++) {
+      values[ch] = 1024 + (j + ch) % 3;
+    }
+    size_t len = publisher.encode(source);
+    if (len > 0) {
+      ok = ok && receiver.apply(publisher.getPacket(), len, target);
+    }
+    deltaBytes += len;
+    // the difference is limited by the hysteresis
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      int diff = values[ch] - target.getChannelValuesRaw()[ch];
+      ok = ok && diff <= 2 && diff >= -2;
+    }
+  }
+  Serial.print("apply ->");
+  Serial.println(ok && receiver.isSynchronized()?"OK":"Error");
+  // compared to the 2 frames with 16 bytes which we need for 12 channels
+  Serial.print("reduction ->");
+  Serial.println(deltaBytes * 5 <= frames * 2 * SEND_BUFFER_SIZE?"OK":"Error");
+
+  // a lost packet is detected and the next keyframe resynchronizes
+  source.setThrottle(500);
+  publisher.encode(source);
+  source.setThrottle(600);
+  size_t len = publisher.encode(source);
+  receiver.apply(publisher.getPacket(), len, target);
+  Serial.print("lost ->");
+  Serial.println(!receiver.isSynchronized() && receiver.getLostPackets()==1
+                 ?"OK":"Error");
+  publisher.requestKeyframe();
+  len = publisher.encode(source);
+  receiver.apply(publisher.getPacket(), len, target);
+  Serial.print("keyframe ->");
+  Serial.println(receiver.isSynchronized() && len==DELTA_MAX_PACKET_SIZE &&
+                 memcmp(source.getChannelValuesRaw(),
+                        target.getChannelValuesRaw(),
+                        2 * MAX_CHANNELS)==0?"OK":"Error");
+  Serial.print("invalid ->");
+  Serial.println(!receiver.apply(publisher.getPacket(), 4, target)?"OK":"Error");
+
+  // channel ids >= 12 are rejected without changing the channels
+  uint8_t packet[] = {DELTA_UPDATE, 0, 2, 0x00, 0x07, 12 << 3, 0x01};
+  packet[1] = publisher.getPacket()[1] + 1;
+  unsigned long invalid = receiver.getInvalidPackets();
+  Serial.print("channel id ->");
+  Serial.println(!receiver.apply(packet, sizeof(packet), target) &&
+                 receiver.getInvalidPackets()==invalid + 1 &&
+                 target.getThrottle()==600 && receiver.isSynchronized()
+                 ?"OK":"Error");
+}
+
+// stage which stops the processing if the throttle is low
+struct ThrottleGate {
+  bool process(SpektrumSnapshot& frame) {
+    return frame.channelValues[Throttle] > 100;
+  }
+};
+
+void testPipeline() {
+  Serial.println("***********************");
+  Serial.println("testPipeline ");
+  uint8_t buffer[SEND_BUFFER_SIZE];
+  SpektrumMemoryStream stream(buffer, sizeof(buffer));
+  SpektrumSatellite<uint16_t> satellite(stream);
+  uint8_t csvBuffer[100] = {0};
+  SpektrumMemoryStream csvStream(csvBuffer, sizeof(csvBuffer) - 1);
+
+  // elevon mixer
+  SpektrumMixer mixer;
+  mixer.addRule(Aileron, Aileron, 50);
+  mixer.addRule(Aileron, Elevator, 50);
+  mixer.addRule(Elevator, Aileron, -50);
+  mixer.addRule(Elevator, Elevator, 50);
+  ThrottleGate gate;
+  SpektrumCSVSink csv(csvStream);
+  auto pipeline = spektrumPipeline(satellite, gate, mixer, csv);
+
+  satellite.setChannelValueRaw(Throttle, 1000);
+  satellite.setChannelValueRaw(Aileron, 1536);
+  satellite.setChannelValueRaw(Elevator, 768);
+  satellite.sendData();
+  Serial.print("process ->");
+  Serial.println(pipeline.process() && pipeline.size()==3?"OK":"Error");
+  Serial.print("csv ->");
+  const char* expected = "1000,1152,640,0,0,0,0,0,0,0,0,0\n";
+  Serial.println(strcmp((char*)csvBuffer, expected)==0?"OK":"Error");
+
+  // the gate stops the processing
+  csvStream.clear();
+  stream.clear();
+  satellite.setChannelValueRaw(Throttle, 0);
+  satellite.sendData();
+  Serial.print("stop ->");
+  Serial.println(!pipeline.process() && csvStream.size()==0?"OK":"Error");
+  // the stages after the gate have only seen the first frame
+  Serial.print("profile ->");
+  Serial.println(pipeline.getStatistics(0).count==2 &&
+                 pipeline.getStatistics(1).count==2 &&
+                 pipeline.getStatistics(2).count==1 &&
+                 pipeline.getStatistics(3).count==1?"OK":"Error");
+
+  // frames from other sources
+  SpektrumLowPassFilter filter(1, 1 << Throttle);
+  SpektrumRangeTransform range(1000, 1100, 1 << Aileron);
+  Scaler<uint16_t> scaler;
+  scaler.setValues(0, 2048, 1000, 2000);
+  SpektrumScalerTransform<uint16_t> scale(scaler, 1 << Rudder);
+  auto transforms = spektrumPipeline(satellite, filter, range, scale);
+  SpektrumSnapshot frame = {{0}, 0, DSMX_11MS_2048, 0};
+  transforms.process(frame);
+  frame.channelValues[Throttle] = 1000;
+  frame.channelValues[Aileron] = 1024;
+  frame.channelValues[Rudder] = 512;
+  transforms.process(frame);
+  Serial.print("transforms ->");
+  Serial.println(frame.channelValues[Throttle]==500 &&
+                 frame.channelValues[Aileron]==1050 &&
+                 frame.channelValues[Rudder]==1250?"OK":"Error");
+}
+
+// Feeds the generated frames one by one to the receiver: returns the number
+// of frames with unexpected channel values and the longest sequence of them
+// in maxResync
+long decodeLoad(SpektrumLoadGenerator& generator, BindMode mode, long frames,
+                long& maxResync) {
+  uint8_t buffer[4 * SEND_BUFFER_SIZE];
+  SpektrumMemoryStream stream(buffer, sizeof(buffer));
+  SpektrumSatellite<uint16_t> receiver(stream);
+  receiver.setBindingMode(mode);
+  uint16_t expected[MAX_CHANNELS];
+  long errors = 0, resync = 0;
+  maxResync = 0;
+  for (long j = 0; j < frames; j++) {
+    generator.write(stream);
+    receiver.getFrame();
+    if (stream.available() == 0) stream.clear();
+    generator.getExpectedValues(0, j, expected);
+    bool ok = memcmp(expected, receiver.getChannelValuesRaw(),
+                     sizeof(expected)) == 0;
+    resync = ok ? 0 : resync + 1;
+    if (resync > maxResync) maxResync = resync;
+    if (!ok) errors++;
+  }
+  return errors;
+}
+
+void testLoadGenerator() {
+  Serial.println("***********************");
+  Serial.println("testLoadGenerator ");
+  long maxResync;
+
+  // all systems and bind modes are decoded without errors
+  const BindMode modes[] = {Internal_DSM2_22ms, External_DSM2_22ms,
+                            Internal_DSM2_11ms, External_DSM2_11ms,
+                            Internal_DSMx_22ms, External_DSMx_22ms,
+                            Internal_DSMx_11ms, External_DSMx_11ms};
+  bool ok = true;
+  for (BindMode mode : modes) {
+    SpektrumLoadGenerator generator;
+    generator.setBindingMode(mode);
+    generator.setAuxInterleave(1);
+    ok = ok && decodeLoad(generator, mode, 500, maxResync) == 0;
+  }
+  Serial.print("clean ->");
+  Serial.println(ok?"OK":"Error");
+
+  // the faults are injected with the requested rates and the receiver
+  // resynchronizes within a few frames
+  SpektrumLoadGenerator faulty(7);
+  faulty.setAuxInterleave(1);
+  faulty.setFaults(20, 20, 20);
+  long errors = decodeLoad(faulty, Internal_DSMx_11ms, 5000, maxResync);
+  Serial.print("faults ->");
+  Serial.println(faulty.getDroppedBytes() > 60 &&
+                 faulty.getDroppedBytes() < 140 &&
+                 faulty.getBitFlips() > 60 && faulty.getBitFlips() < 140 &&
+                 faulty.getTruncatedFrames() > 60 &&
+                 faulty.getTruncatedFrames() < 140?"OK":"Error");
+  Serial.print("resync ->");
+  Serial.println(errors > 0 && maxResync <= 6?"OK":"Error");
+
+  // the frames of the virtual satellites differ and can be reproduced
+  SpektrumLoadGenerator many;
+  many.setSatellites(1000);
+  uint8_t first[SEND_BUFFER_SIZE], frame[SEND_BUFFER_SIZE];
+  many.next(first);
+  for (int j = 1; j < 1000; j++) {
+    many.next(frame);
+    ok = ok && memcmp(first, frame, SEND_BUFFER_SIZE) != 0;
+  }
+  many.next(frame);
+  ok = ok && many.getSatellite() == 0 && many.getFrameNumber() == 1;
+  many.generate(999, 0, first);
+  many.generate(999, 0, frame);
+  ok = ok && memcmp(first, frame, SEND_BUFFER_SIZE) == 0;
+  Serial.print("satellites ->");
+  Serial.println(ok?"OK":"Error");
+
+  // the jitter stays within the limit
+  many.setPeriod(11000, 500);
+  ok = true;
+  for (uint32_t j = 1; j < 100; j++) {
+    long diff = many.getFrameTimeUs(5, j) - 11000 * j;
+    ok = ok && diff >= -500 && diff <= 500;
+  }
+  Serial.print("jitter ->");
+  Serial.println(ok?"OK":"Error");
+
+  // the time does not overflow after 71 minutes
+  many.setPeriod(11000, 0);
+  Serial.print("time ->");
+  Serial.println(many.getFrameTimeUs(0, 400000) == 4400000000ULL?"OK":"Error");
+}
+
+void testSnapshot() {
+  Serial.println("***********************");
+  Serial.println("testSnapshot ");
+  uint8_t buffer[SEND_BUFFER_SIZE];
+  SpektrumMemoryStream stream(buffer, sizeof(buffer));
+  SpektrumSatellite<uint16_t> satellite(stream);
+  satellite.setThrottle(100);
+  SpektrumSnapshot snapshot;
+  satellite.readSnapshot(snapshot);
+  Serial.print("readSnapshot ->");
+  Serial.println(snapshot.channelValues[Throttle]==100 &&
+                 snapshot.system==DSMX_11MS_2048?"OK":"Error");
+
+  // getFrame() stamps the whole frame with the time of the read
+  SpektrumSatellite<uint16_t, SpektrumWithSnapshot> stamped(stream);
+  stream.clear();
+  stamped.setThrottle(200);
+  stamped.sendData();
+  unsigned long before = millis();
+  stamped.getFrame();
+  unsigned long after = millis();
+  stamped.readSnapshot(snapshot);
+  Serial.print("timestamp ->");
+  Serial.println(snapshot.channelValues[Throttle]==200 &&
+                 snapshot.timestamp >= before && snapshot.timestamp <= after
+                 ?"OK":"Error");
+
+#ifdef TEST_THREADS
+  // the writer updates channels 0-6 and the fades with the same value: a
+  // reader must never see a mix of two frames
+  SpektrumSatellite<uint16_t, SpektrumWithSnapshot> shared(stream);
+  const long reads = 200000;
+  volatile bool running = true;
+  std::thread writer([&]() {
+    Data data;
+    for (long j = 0; running; j++) {
+      uint16_t value = j % 2048;
+      data.header.internal.fades = value & 0xff;
+      data.header.internal.system = DSMX_11MS_2048;
+      for (int ch = 0; ch < 7; ch++) {
+        uint16_t word = (ch << 11) | value;
+        data.values[ch] = (word << 8) | (word >> 8);
+      }
+      shared.parseFrame(&data);
+    }
+  });
+  long torn[2] = {0};
+  auto reader = [&](int id) {
+    SpektrumSnapshot snapshot;
+    for (long j = 0; j < reads; j++) {
+      shared.readSnapshot(snapshot);
+      bool ok = (snapshot.fades == (snapshot.channelValues[0] & 0xff));
+      for (int ch = 1; ch < 7; ch++) {
+        ok = ok && snapshot.channelValues[ch] == snapshot.channelValues[0];
+      }
+      if (!ok) torn[id]++;
+    }
+  };
+  std::thread reader1(reader, 1);
+  reader(0);
+  reader1.join();
+  running = false;
+  writer.join();
+  Serial.print("concurrent reads ->");
+  Serial.println(torn[0] + torn[1] == 0 ? "OK" : "Error");
+
+  // a delta keyframe updates all 12 channels as one
+  SpektrumSatellite<uint16_t, SpektrumWithSnapshot> target(stream);
+  running = true;
+  std::thread deltaWriter([&]() {
+    SpektrumDeltaPublisher publisher(1);
+    SpektrumDeltaReceiver receiver;
+    uint16_t values[MAX_CHANNELS];
+    for (long j = 0; running; j++) {
+      for (int ch = 0; ch < MAX_CHANNELS; ch++) values[ch] = j % 2048;
+      size_t len = publisher.encode(values);
+      receiver.apply(publisher.getPacket(), len, target);
+    }
+  });
+  long tornDelta = 0;
+  for (long j = 0; j < reads; j++) {
+    target.readSnapshot(snapshot);
+    for (int ch = 1; ch < MAX_CHANNELS; ch++) {
+      if (snapshot.channelValues[ch] != snapshot.channelValues[0]) {
+        tornDelta++;
+        break;
+      }
+    }
+  }
+  running = false;
+  deltaWriter.join();
+  Serial.print("concurrent delta ->");
+  Serial.println(tornDelta == 0 ? "OK" : "Error");
+#endif
+}
+
+#if defined(SPEKTRUM_SHARED_MEMORY) && !defined(ARDUINO)
+// consistency check of a published frame
+bool isValidSharedFrame(SpektrumSharedFrame& frame) {
+  bool ok = frame.fades == frame.generation % 256;
+  for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+    ok = ok && frame.channelValues[ch] == frame.generation % 2048;
+  }
+  return ok;
+}
+
+void testSharedMemory() {
+  Serial.println("***********************");
+  Serial.println("testSharedMemory ");
+  const char* name = "/spektrum-test";
+  const uint64_t frames = 100000;
+  SpektrumSharedMemoryPublisher publisher(name, 64);
+  // we start with a new ring
+  publisher.remove();
+  Serial.print("begin ->");
+  Serial.println(publisher.begin()?"OK":"Error");
+
+  // the reader process follows the history until the last frame
+  pid_t pid = fork();
+  if (pid == 0) {
+    SpektrumSharedMemoryReader reader(name);
+    if (!reader.begin()) _exit(1);
+    SpektrumSharedFrame frame;
+    uint64_t next = 1;
+    long reads = 0, errors = 0;
+    while (next <= frames) {
+      if (next > reader.getGeneration()) continue;
+      if (next < reader.getOldestGeneration()) {
+        next = reader.getOldestGeneration();
+      }
+      if (reader.read(next, frame)) {
+        if (!isValidSharedFrame(frame) || frame.generation != next) errors++;
+        reads++;
+        next++;
+      }
+    }
+    _exit(reads > 0 && errors == 0 ? 0 : 2);
+  }
+
+  SpektrumSnapshot snapshot;
+  for (uint64_t generation = 1; generation <= frames; generation++) {
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      snapshot.channelValues[ch] = generation % 2048;
+    }
+    snapshot.fades = generation % 256;
+    snapshot.system = DSMX_11MS_2048;
+    snapshot.timestamp = millis();
+    publisher.publish(snapshot);
+  }
+  int status = -1;
+  waitpid(pid, &status, 0);
+  Serial.print("reader process ->");
+  Serial.println(WIFEXITED(status) && WEXITSTATUS(status)==0?"OK":"Error");
+
+  SpektrumSharedMemoryReader reader(name);
+  SpektrumSharedFrame frame;
+  Serial.print("readLatest ->");
+  Serial.println(reader.begin() && reader.readLatest(frame) &&
+                 frame.generation==frames && isValidSharedFrame(frame)
+                 ?"OK":"Error");
+  Serial.print("overwritten ->");
+  Serial.println(!reader.read(frames - 64, frame)?"OK":"Error");
+
+  // a restarted publisher keeps the ring of the attached reader
+  SpektrumSharedMemoryPublisher restarted(name, 64);
+  Serial.print("restart ->");
+  Serial.println(restarted.begin() && reader.readLatest(frame) &&
+                 frame.generation==frames?"OK":"Error");
+  restarted.publish(snapshot);
+  Serial.print("continue ->");
+  Serial.println(reader.getGeneration()==frames + 1?"OK":"Error");
+
+  // a different layout is reinitialized
+  reader.end();
+  SpektrumSharedMemoryPublisher resized(name, 32);
+  Serial.print("resize ->");
+  Serial.println(resized.begin() && resized.getCapacity()==32 &&
+                 resized.getGeneration()==0 && reader.begin() &&
+                 reader.getCapacity()==32?"OK":"Error");
+  publisher.remove();
+}
+#endif
+
+// The sizes of the README on a 64 bit host: the profiler of this sketch is
+// not part of them
+#if defined(__x86_64__) && !defined(ARDUINO)
+template <int Options>
+bool isSize(size_t expected) {
+  return sizeof(SpektrumSatellite<uint16_t, Options>) -
+             sizeof(SpektrumProfiler) == expected;
+}
+
+void testFootprint() {
+  Serial.println("***********************");
+  Serial.println("testFootprint ");
+  const int minimal = SpektrumNoScaler | SpektrumNoStats | SpektrumNoLog;
+  Serial.print("default ->");
+  Serial.println(isSize<SpektrumDefault>(208)?"OK":"Error");
+  Serial.print("receive only ->");
+  Serial.println(isSize<SpektrumReceiveOnly>(192)?"OK":"Error");
+  Serial.print("send only ->");
+  Serial.println(isSize<SpektrumSendOnly>(136)?"OK":"Error");
+  Serial.print("options ->");
+  Serial.println(isSize<SpektrumNoScaler>(200) &&
+                 isSize<SpektrumNoStats>(176) && isSize<SpektrumNoLog>(192)
+                 ?"OK":"Error");
+  Serial.print("minimal ->");
+  Serial.println(isSize<SpektrumReceiveOnly | minimal>(128) &&
+                 isSize<SpektrumSendOnly | minimal>(72)?"OK":"Error");
+  Serial.print("optional ->");
+  Serial.println(isSize<SpektrumWithChannelMap>(224) &&
+                 isSize<SpektrumWithFailsafe>(240) &&
+                 isSize<SpektrumWithCallbacks>(256) &&
+                 isSize<SpektrumWithSnapshot>(224)?"OK":"Error");
+  Serial.print("all ->");
+  Serial.println(isSize<SpektrumAll>(320)?"OK":"Error");
+}
+#endif
 
 void setup() {
   Serial.begin(115200);
@@ -195,6 +1146,24 @@ void setup() {
   testHeader();
   testCSV();
   testBinary();
+  testBinding();
+  testCallbacks();
+  testFailsafe();
+  testProfiler();
+  testBulkDecoder();
+  testSBUS();
+  testCPPM();
+  testChannelMap();
+  testDelta();
+  testPipeline();
+  testLoadGenerator();
+  testSnapshot();
+#if defined(SPEKTRUM_SHARED_MEMORY) && !defined(ARDUINO)
+  testSharedMemory();
+#endif
+#if defined(__x86_64__) && !defined(ARDUINO)
+  testFootprint();
+#endif
   testWaitForData();
 }
 
@@ -0,0 +1,59 @@
+/**
+ * Host build of the Benchmark example on Linux or macOS: we use the Arduino.h
+ * of the SpektrumConverter (Serial writes the JSON to stdout) and count the
+ * calls of new and (with glibc) malloc, so that the benchmark can report the
+ * allocations of each measurement.
+ *
+ * Build with make and run ./spektrum-benchmark > result.json
+ * @author Phil Schatzmann
+ */
+
+#include <new>
+
+#include "Arduino.h"
+
+#define BENCH_COUNT_ALLOCATIONS
+long benchAllocations = 0;
+
+#if defined(__GLIBC__)
+// we replace malloc: new uses it as well, so it is counted only once here
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size) {
+  benchAllocations++;
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+  benchAllocations++;
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+  benchAllocations++;
+  return __libc_realloc(ptr, size);
+}
+#else
+void* operator new(size_t size) {
+  benchAllocations++;
+  void* result = malloc(size);
+  if (result == NULL) throw std::bad_alloc();
+  return result;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+
+void operator delete[](void* ptr) noexcept { free(ptr); }
+#endif
+
+#include "../../examples/Benchmark/Benchmark.ino"
+
+int main() {
+  setup();
+  Serial.flush();
+  return 0;
+}
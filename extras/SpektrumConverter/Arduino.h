@@ -0,0 +1,193 @@
+/**
+ * Minimal subset of the Arduino API which is needed to use the
+ * SpektrumSatellite library in a host program (e.g. the SpektrumConverter).
+ * The pin functions do nothing, the time is taken from the steady_clock,
+ * random() uses the random() of the C library and Serial writes to stdout and
+ * reads from stdin.
+ * @author Phil Schatzmann
+ */
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+#define HEX 16
+#define DEC 10
+#define INPUT 0
+#define OUTPUT 1
+#define LOW 0
+#define HIGH 1
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+inline unsigned long micros() {
+  static auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+inline unsigned long millis() { return micros() / 1000; }
+
+inline void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+inline void pinMode(int pin, int mode) {}
+
+inline void digitalWrite(int pin, int value) {}
+
+// Arduino random numbers: from 0 to max - 1 or from min to max - 1
+inline long random(long max) { return max > 0 ? ::random() % max : 0; }
+
+inline long random(long min, long max) {
+  return max > min ? min + random(max - min) : min;
+}
+
+inline void randomSeed(unsigned long seed) { srandom(seed); }
+
+inline char* itoa(int value, char* str, int base) {
+  sprintf(str, base == HEX ? "%x" : "%d", value);
+  return str;
+}
+
+/**
+ * @brief Output of text and binary data
+ */
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t result = 0;
+    while (size--) result += write(*buffer++);
+    return result;
+  }
+
+  size_t print(const char* str) {
+    return write((const uint8_t*)str, strlen(str));
+  }
+
+  size_t print(char c) { return write((uint8_t)c); }
+
+  size_t print(long value, int base = DEC) {
+    char str[24];
+    snprintf(str, sizeof(str), base == HEX ? "%lx" : "%ld", value);
+    return print(str);
+  }
+
+  size_t print(unsigned long value, int base = DEC) {
+    char str[24];
+    snprintf(str, sizeof(str), base == HEX ? "%lx" : "%lu", value);
+    return print(str);
+  }
+
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+
+  size_t print(unsigned value, int base = DEC) {
+    return print((unsigned long)value, base);
+  }
+
+  size_t print(double value, int decimals = 2) {
+    char str[48];
+    snprintf(str, sizeof(str), "%.*f", decimals, value);
+    return print(str);
+  }
+
+  size_t println() { return print("\r\n"); }
+
+  template <class V>
+  size_t println(V value) {
+    return print(value) + println();
+  }
+
+  template <class V>
+  size_t println(V value, int format) {
+    return print(value, format) + println();
+  }
+
+  virtual void flush() {}
+};
+
+/**
+ * @brief Input of data
+ */
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  size_t readBytes(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+      int c = read();
+      if (c < 0) break;
+      buffer[count++] = c;
+    }
+    return count;
+  }
+
+  size_t readBytes(char* buffer, size_t length) {
+    return readBytes((uint8_t*)buffer, length);
+  }
+};
+
+/**
+ * @brief Serial of the host: the output is written to stdout and the input is
+ * read from stdin (unbuffered, so that available() is exact)
+ */
+class HostSerial : public Stream {
+ public:
+  void begin(unsigned long bps) {}
+
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    return fwrite(buffer, 1, size, stdout);
+  }
+
+  int available() override {
+    int count = 0;
+    if (ioctl(STDIN_FILENO, FIONREAD, &count) != 0) return 0;
+    return count + (peeked >= 0 ? 1 : 0);
+  }
+
+  int read() override {
+    int result = peek();
+    peeked = -1;
+    return result;
+  }
+
+  int peek() override {
+    uint8_t c;
+    if (peeked < 0 && available() > 0 && ::read(STDIN_FILENO, &c, 1) == 1) {
+      peeked = c;
+    }
+    return peeked;
+  }
+
+  void flush() override { fflush(stdout); }
+
+  operator bool() { return true; }
+
+ private:
+  int peeked = -1;
+};
+
+static HostSerial Serial;
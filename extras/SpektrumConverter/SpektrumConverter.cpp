@@ -0,0 +1,610 @@
+/**
+ * Command line tool which converts between raw 16 byte frame captures, CSV
+ * lines (as written by SpektrumCSV::toString()) and a columnar binary layout.
+ *
+ * The input is mapped into memory and split into chunks which are converted
+ * on all cores. The output keeps the order of the input. The conversion uses
+ * the SpektrumCSV, SpektrumSatellite and SpektrumBulkDecoder of the library,
+ * so that the formats are always identical to the ones of the Arduino code.
+ *
+ * Formats:
+ * - raw: 16 byte frames. A frame only contains 7 channels, so each channel
+ *   keeps the value of the previous frames (like in parseFrame()). We write
+ *   a main frame followed by an aux frame for each record.
+ * - csv: one line with 12 values per record (see SpektrumCSV)
+ * - col: ColumnarHeader followed by the 12 channel columns (uint16_t), the
+ *   fades (uint16_t) and the system (uint8_t) of all records
+ *
+ * Build on Linux or macOS with make: the Arduino.h in this directory provides
+ * the Arduino API which is needed by the library.
+ *
+ * Usage: spektrum-converter [options] <from> <to> <input> <output>
+ * with from and to = raw, csv or col
+ *   -j threads      number of threads (default: number of cores)
+ *   -r min max      range of the CSV values (see setChannelValueRange())
+ *   -d decimals     decimals of the CSV values (default 2)
+ *   -s delimiter    delimiter of the CSV values (default ,)
+ *   -u              the CSV contains the raw channel values
+ *   -y 1024|2048    system of the frames which are written (default 2048)
+ *   -e              the raw frames use the external header (no system byte)
+ * @author Phil Schatzmann
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "SpektrumBulkDecoder.h"
+#include "SpektrumCSV.h"
+#include "SpektrumMemoryStream.h"
+#include "SpektrumSatellite.h"
+
+#define CHUNK_SIZE (4 * 1024 * 1024)
+#define COLUMNAR_MAGIC "SPKC"
+#define COLUMNAR_VERSION 1
+#define CSV_MAX_LINE 512
+#define CSV_MAX_DECIMALS 9
+// channel value which is never decoded: the channel was not in the chunk yet
+#define UNDEFINED_VALUE 0xFFFF
+
+enum Format { Raw, CSV, Columnar };
+
+// Start of a columnar file
+struct ColumnarHeader {
+  char magic[4];
+  uint16_t version;
+  uint8_t system;
+  uint8_t isInternal;
+  uint64_t count;
+};
+
+// Command line options
+struct Options {
+  Format from;
+  Format to;
+  const char* input;
+  const char* output;
+  int threads = std::thread::hardware_concurrency();
+  bool isRange = false;
+  float min = 0;
+  float max = 0;
+  int decimals = 2;
+  char delimiter = ',';
+  bool isTranslated = true;
+  System system = DSMX_11MS_2048;
+  bool isInternal = true;
+};
+
+// Part of the input which is converted by one thread
+struct Chunk {
+  // byte range of raw and csv input
+  size_t begin;
+  size_t end;
+  uint64_t firstRecord;
+  uint64_t records;
+  // decoded data (not used if we write a columnar file)
+  std::vector<uint16_t> values;
+  std::vector<uint8_t> systems;
+  SpektrumColumns columns;
+  std::string output;
+};
+
+/**
+ * @brief Read only memory mapping of the input file
+ */
+class MappedFile {
+ public:
+  ~MappedFile() {
+    if (data != NULL && size > 0) munmap((void*)data, size);
+  }
+
+  bool open(const char* path) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      close(fd);
+      return false;
+    }
+    size = info.st_size;
+    if (size > 0) {
+      void* memory = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (memory == MAP_FAILED) memory = NULL;
+      data = (const uint8_t*)memory;
+      madvise(memory, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    return size == 0 || data != NULL;
+  }
+
+  const uint8_t* data = NULL;
+  size_t size = 0;
+};
+
+/**
+ * @brief Converts the chunks of the input into the output format
+ */
+class Converter {
+ public:
+  Converter(Options& options) : options(options) {}
+
+  bool convert() {
+    if (!input.open(options.input)) {
+      fprintf(stderr, "Could not open %s\n", options.input);
+      return false;
+    }
+    if (!split()) return false;
+    if (options.to == Columnar) {
+      if (!openColumnarOutput()) return false;
+    } else {
+      out = fopen(options.output, "wb");
+      if (out == NULL) {
+        fprintf(stderr, "Could not create %s\n", options.output);
+        return false;
+      }
+    }
+
+    // we process as many chunks as we have threads and write them in order
+    size_t threads = options.threads > 0 ? options.threads : 1;
+    for (size_t start = 0; start < chunks.size(); start += threads) {
+      size_t end = std::min(start + threads, chunks.size());
+      parallel(start, end, &Converter::decode);
+      if (options.from == Raw) resolveUndefined(start, end);
+      if (options.to != Columnar) {
+        parallel(start, end, &Converter::encode);
+        for (size_t j = start; j < end; j++) {
+          fwrite(chunks[j].output.data(), 1, chunks[j].output.size(), out);
+          chunks[j] = Chunk();
+        }
+      }
+    }
+    return close();
+  }
+
+  uint64_t getRecords() { return records; }
+
+  size_t getInputSize() { return input.size; }
+
+  unsigned long getInvalidRecords() { return invalidRecords; }
+
+ private:
+  Options& options;
+  MappedFile input;
+  std::vector<Chunk> chunks;
+  uint64_t records = 0;
+  std::atomic<unsigned long> invalidRecords{0};
+  FILE* out = NULL;
+  uint8_t* outputMap = NULL;
+  size_t outputSize = 0;
+  SpektrumColumns inputColumns;
+  SpektrumColumns outputColumns;
+  // system of the input (or of the options)
+  System system;
+  // values at the end of the last raw chunk
+  uint16_t lastValues[MAX_CHANNELS];
+
+  // Determines the chunks and the number of records in each chunk
+  bool split() {
+    const uint8_t* data = input.data;
+    size_t size = input.size;
+    system = options.system;
+    if (options.from == Columnar) {
+      ColumnarHeader header;
+      if (size < sizeof(header)) return invalidColumnar();
+      memcpy(&header, data, sizeof(header));
+      if (memcmp(header.magic, COLUMNAR_MAGIC, 4) != 0 ||
+          header.version != COLUMNAR_VERSION ||
+          size < sizeof(header) + header.count * 27) {
+        return invalidColumnar();
+      }
+      records = header.count;
+      system = (System)header.system;
+      setColumns(inputColumns, (uint8_t*)data, records);
+      uint64_t perChunk = CHUNK_SIZE / 27;
+      for (uint64_t first = 0; first < records; first += perChunk) {
+        Chunk chunk;
+        chunk.firstRecord = first;
+        chunk.records = std::min(perChunk, records - first);
+        chunks.push_back(chunk);
+      }
+      return true;
+    }
+
+    // split raw data at the frames and csv data at the lines
+    size_t begin = 0;
+    while (begin < size) {
+      size_t end = std::min(begin + CHUNK_SIZE, size);
+      if (options.from == Raw) {
+        end -= (end - begin) % SEND_BUFFER_SIZE;
+        if (end == begin) break;
+      } else {
+        const void* newline = memchr(data + end - 1, '\n', size - end + 1);
+        end = newline != NULL ? (const uint8_t*)newline - data + 1 : size;
+      }
+      Chunk chunk;
+      chunk.begin = begin;
+      chunk.end = end;
+      chunks.push_back(chunk);
+      begin = end;
+    }
+    if (options.from == Raw) {
+      if (size % SEND_BUFFER_SIZE != 0) {
+        fprintf(stderr, "Ignoring %zu bytes at the end of the input\n",
+                size % SEND_BUFFER_SIZE);
+      }
+      // like parseFrame() we use the system of the first frame
+      SpektrumBulkDecoder decoder(DSMX_11MS_2048, options.isInternal);
+      if (size >= SEND_BUFFER_SIZE) decodeFirstFrame(decoder);
+      system = decoder.getSystem();
+      for (int ch = 0; ch < MAX_CHANNELS; ch++) lastValues[ch] = 0;
+    } else {
+      parallel(0, chunks.size(), &Converter::countLines);
+    }
+    for (Chunk& chunk : chunks) {
+      if (options.from == Raw) {
+        chunk.records = (chunk.end - chunk.begin) / SEND_BUFFER_SIZE;
+      }
+      chunk.firstRecord = records;
+      records += chunk.records;
+    }
+    return true;
+  }
+
+  bool invalidColumnar() {
+    fprintf(stderr, "%s is not a valid columnar file\n", options.input);
+    return false;
+  }
+
+  void countLines(Chunk& chunk) {
+    chunk.records = 0;
+    for (size_t pos = chunk.begin; pos < chunk.end;) {
+      const uint8_t* newline =
+          (const uint8_t*)memchr(input.data + pos, '\n', chunk.end - pos);
+      size_t end = newline != NULL ? newline - input.data : chunk.end;
+      if (!isEmptyLine(pos, end)) chunk.records++;
+      pos = end + 1;
+    }
+  }
+
+  bool isEmptyLine(size_t begin, size_t end) {
+    return end == begin || (end == begin + 1 && input.data[begin] == '\r');
+  }
+
+  // Points the columns to the memory of a columnar file
+  static void setColumns(SpektrumColumns& columns, uint8_t* data,
+                         uint64_t count) {
+    uint8_t* start = data + sizeof(ColumnarHeader);
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      columns.channels[ch] = (uint16_t*)(start + ch * count * 2);
+    }
+    columns.fades = (uint16_t*)(start + MAX_CHANNELS * count * 2);
+    columns.system = start + (MAX_CHANNELS + 1) * count * 2;
+  }
+
+  // Columns of the chunk: the file columns at the offset of the chunk or
+  // the memory of the chunk
+  SpektrumColumns& getColumns(Chunk& chunk, SpektrumColumns* file) {
+    SpektrumColumns& columns = chunk.columns;
+    if (file != NULL) {
+      for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+        columns.channels[ch] = file->channels[ch] + chunk.firstRecord;
+      }
+      columns.fades = file->fades + chunk.firstRecord;
+      columns.system = file->system + chunk.firstRecord;
+    } else {
+      chunk.values.resize((MAX_CHANNELS + 1) * chunk.records);
+      chunk.systems.resize(chunk.records);
+      for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+        columns.channels[ch] = chunk.values.data() + ch * chunk.records;
+      }
+      columns.fades = chunk.values.data() + MAX_CHANNELS * chunk.records;
+      columns.system = chunk.systems.data();
+    }
+    return columns;
+  }
+
+  bool openColumnarOutput() {
+    outputSize = sizeof(ColumnarHeader) + records * 27;
+    int fd = open(options.output, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, outputSize) != 0) {
+      fprintf(stderr, "Could not create %s\n", options.output);
+      if (fd >= 0) ::close(fd);
+      return false;
+    }
+    void* memory =
+        mmap(NULL, outputSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+      fprintf(stderr, "Could not map %s\n", options.output);
+      return false;
+    }
+    outputMap = (uint8_t*)memory;
+    ColumnarHeader header;
+    memcpy(header.magic, COLUMNAR_MAGIC, 4);
+    header.version = COLUMNAR_VERSION;
+    header.system = system;
+    header.isInternal = options.isInternal;
+    header.count = records;
+    memcpy(outputMap, &header, sizeof(header));
+    setColumns(outputColumns, outputMap, records);
+    return true;
+  }
+
+  bool close() {
+    bool result = true;
+    if (outputMap != NULL) {
+      result = munmap(outputMap, outputSize) == 0;
+    }
+    if (out != NULL) {
+      result = fclose(out) == 0 && result;
+    }
+    return result;
+  }
+
+  // Calls the method for the chunks from start to end on all threads
+  void parallel(size_t start, size_t end, void (Converter::*method)(Chunk&)) {
+    std::atomic<size_t> next(start);
+    std::vector<std::thread> threads;
+    int count = std::min((size_t)options.threads, end - start);
+    for (int j = 0; j < count; j++) {
+      threads.push_back(std::thread([&]() {
+        for (size_t index = next++; index < end; index = next++) {
+          (this->*method)(chunks[index]);
+        }
+      }));
+    }
+    for (std::thread& thread : threads) thread.join();
+  }
+
+  // Creates a satellite which has the same settings as the Arduino code
+  void setup(SpektrumSatellite<float>& satellite) {
+    satellite.setBindingMode(options.isInternal ? Internal_DSMx_11ms
+                                                : External_DSMx_11ms);
+    satellite.setSystem(system);
+    if (options.isRange) {
+      satellite.setChannelValueRange(options.min, options.max);
+    }
+  }
+
+  void decodeFirstFrame(SpektrumBulkDecoder& decoder) {
+    uint16_t values[MAX_CHANNELS + 1];
+    uint8_t system;
+    SpektrumColumns columns;
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      columns.channels[ch] = values + ch;
+    }
+    columns.fades = values + MAX_CHANNELS;
+    columns.system = &system;
+    decoder.decodeScalar(input.data, 0, columns);
+  }
+
+  // Converts the input of the chunk into columns
+  void decode(Chunk& chunk) {
+    SpektrumColumns* file = options.to == Columnar ? &outputColumns : NULL;
+    if (options.from == Columnar) {
+      // the input is already decoded
+      SpektrumColumns& columns = getColumns(chunk, &inputColumns);
+      if (file != NULL) copy(columns, chunk, *file);
+      return;
+    }
+    SpektrumColumns& columns = getColumns(chunk, file);
+    if (options.from == Raw) {
+      decodeRaw(chunk, columns);
+    } else {
+      decodeCSV(chunk, columns);
+    }
+  }
+
+  void copy(SpektrumColumns& from, Chunk& chunk, SpektrumColumns& to) {
+    uint64_t first = chunk.firstRecord;
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      memcpy(to.channels[ch] + first, from.channels[ch], 2 * chunk.records);
+    }
+    memcpy(to.fades + first, from.fades, 2 * chunk.records);
+    memcpy(to.system + first, from.system, chunk.records);
+  }
+
+  // The channels which are not in the chunk yet are UNDEFINED_VALUE: they
+  // are resolved with the values at the end of the previous chunk
+  void decodeRaw(Chunk& chunk, SpektrumColumns& columns) {
+    SpektrumBulkDecoder decoder(DSMX_11MS_2048, options.isInternal);
+    decodeFirstFrame(decoder);
+    uint16_t* values = decoder.getChannelValuesRaw();
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) values[ch] = UNDEFINED_VALUE;
+    decoder.decode(input.data + chunk.begin, chunk.records, columns);
+  }
+
+  void resolveUndefined(size_t start, size_t end) {
+    for (size_t j = start; j < end; j++) {
+      Chunk& chunk = chunks[j];
+      if (chunk.records == 0) continue;
+      for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+        uint16_t* column = chunk.columns.channels[ch];
+        for (uint64_t row = 0;
+             row < chunk.records && column[row] == UNDEFINED_VALUE; row++) {
+          column[row] = lastValues[ch];
+        }
+        lastValues[ch] = column[chunk.records - 1];
+      }
+    }
+  }
+
+  void decodeCSV(Chunk& chunk, SpektrumColumns& columns) {
+    uint8_t buffer[SEND_BUFFER_SIZE];
+    SpektrumMemoryStream stream(buffer, sizeof(buffer));
+    SpektrumSatellite<float> satellite(stream);
+    setup(satellite);
+    SpektrumCSV<float> csv(options.delimiter, options.decimals,
+                           options.isTranslated);
+    uint8_t line[CSV_MAX_LINE + 2];
+    uint16_t* values = satellite.getChannelValuesRaw();
+    uint64_t row = 0;
+    for (size_t pos = chunk.begin; pos < chunk.end;) {
+      const uint8_t* newline =
+          (const uint8_t*)memchr(input.data + pos, '\n', chunk.end - pos);
+      size_t end = newline != NULL ? newline - input.data : chunk.end;
+      if (!isEmptyLine(pos, end)) {
+        // the parser needs a terminated line
+        size_t len = std::min(end - pos, (size_t)CSV_MAX_LINE);
+        memcpy(line, input.data + pos, len);
+        line[len] = '\n';
+        line[len + 1] = 0;
+        if (!csv.parse(line, satellite)) invalidRecords++;
+        for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+          columns.channels[ch][row] = values[ch];
+        }
+        columns.fades[row] = satellite.getFades();
+        columns.system[row] = satellite.getSystem();
+        row++;
+      }
+      pos = end + 1;
+    }
+  }
+
+  // Converts the columns of the chunk into csv lines or raw frames
+  void encode(Chunk& chunk) {
+    SpektrumColumns& columns = chunk.columns;
+    uint8_t buffer[SEND_BUFFER_SIZE];
+    SpektrumMemoryStream stream(buffer, sizeof(buffer));
+    SpektrumSatellite<float> satellite(stream);
+    setup(satellite);
+    SpektrumCSV<float> csv(options.delimiter, options.decimals,
+                           options.isTranslated);
+    uint16_t* values = satellite.getChannelValuesRaw();
+    char line[CSV_MAX_LINE];
+    chunk.output.reserve(options.to == Raw
+                             ? 2 * SEND_BUFFER_SIZE * chunk.records
+                             : 8 * MAX_CHANNELS * chunk.records);
+    for (uint64_t row = 0; row < chunk.records; row++) {
+      for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+        values[ch] = columns.channels[ch][row];
+      }
+      if (options.to == CSV && isRawCSV()) {
+        appendRaw(chunk, values);
+      } else if (options.to == CSV) {
+        csv.toString(satellite, (uint8_t*)line, sizeof(line));
+        chunk.output.append(line);
+      } else {
+        appendFrame(chunk, satellite.getSendBuffer(false), columns.fades[row]);
+        appendFrame(chunk, satellite.getSendBuffer(true), columns.fades[row]);
+      }
+    }
+  }
+
+  // Without a range the CSV contains the raw values
+  bool isRawCSV() {
+    return (!options.isTranslated || !options.isRange) &&
+           options.decimals >= 0 && options.decimals <= CSV_MAX_DECIMALS;
+  }
+
+  // Formats the raw values like SpektrumCSV::toString() ("%.2f") but without
+  // the slow float formatting: a value needs at most a delimiter, 5 digits,
+  // the '.' and the decimals
+  void appendRaw(Chunk& chunk, const uint16_t* values) {
+    char line[MAX_CHANNELS * (7 + CSV_MAX_DECIMALS) + 1];
+    char* pos = line;
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      if (ch > 0) *pos++ = options.delimiter;
+      char digits[5];
+      int len = 0;
+      uint16_t value = values[ch];
+      do {
+        digits[len++] = '0' + value % 10;
+        value /= 10;
+      } while (value > 0);
+      while (len > 0) *pos++ = digits[--len];
+      if (options.decimals > 0) {
+        *pos++ = '.';
+        memset(pos, '0', options.decimals);
+        pos += options.decimals;
+      }
+    }
+    *pos++ = '\n';
+    chunk.output.append(line, pos - line);
+  }
+
+  void appendFrame(Chunk& chunk, Data* frame, uint16_t fades) {
+    if (options.isInternal) {
+      frame->header.internal.fades = fades;
+    } else {
+      frame->header.fades = fades;
+    }
+    chunk.output.append((const char*)frame, SEND_BUFFER_SIZE);
+  }
+};
+
+Format parseFormat(const char* name) {
+  if (strcmp(name, "raw") == 0) return Raw;
+  if (strcmp(name, "csv") == 0) return CSV;
+  if (strcmp(name, "col") == 0) return Columnar;
+  fprintf(stderr, "Invalid format: %s\n", name);
+  exit(1);
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: spektrum-converter [-j threads] [-r min max] [-d decimals] "
+          "[-s delimiter] [-u] [-y 1024|2048] [-e] <raw|csv|col> "
+          "<raw|csv|col> <input> <output>\n");
+  exit(1);
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  std::vector<const char*> arguments;
+  for (int j = 1; j < argc; j++) {
+    std::string arg = argv[j];
+    bool hasValue = j + 1 < argc;
+    if (arg == "-j" && hasValue) {
+      options.threads = atoi(argv[++j]);
+    } else if (arg == "-r" && j + 2 < argc) {
+      options.isRange = true;
+      options.min = atof(argv[++j]);
+      options.max = atof(argv[++j]);
+    } else if (arg == "-d" && hasValue) {
+      options.decimals = atoi(argv[++j]);
+    } else if (arg == "-s" && hasValue) {
+      options.delimiter = argv[++j][0];
+    } else if (arg == "-u") {
+      options.isTranslated = false;
+    } else if (arg == "-y" && hasValue) {
+      options.system =
+          atoi(argv[++j]) == 1024 ? DSM2_22MS_1024 : DSMX_11MS_2048;
+    } else if (arg == "-e") {
+      options.isInternal = false;
+    } else if (arg[0] == '-' && arg.size() > 1) {
+      usage();
+    } else {
+      arguments.push_back(argv[j]);
+    }
+  }
+  if (arguments.size() != 4) usage();
+  options.from = parseFormat(arguments[0]);
+  options.to = parseFormat(arguments[1]);
+  options.input = arguments[2];
+  options.output = arguments[3];
+  if (options.threads < 1) options.threads = 1;
+
+  auto start = std::chrono::steady_clock::now();
+  Converter converter(options);
+  if (!converter.convert()) return 1;
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  double mb = converter.getInputSize() / 1e6;
+  fprintf(stderr,
+          "%llu records (%.1f MB) converted in %.3f s with %d threads: %.1f "
+          "MB/s\n",
+          (unsigned long long)converter.getRecords(), mb, seconds,
+          options.threads, seconds > 0 ? mb / seconds : 0);
+  if (converter.getInvalidRecords() > 0) {
+    fprintf(stderr, "%lu invalid records\n", converter.getInvalidRecords());
+  }
+  return 0;
+}
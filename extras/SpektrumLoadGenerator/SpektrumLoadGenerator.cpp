@@ -0,0 +1,260 @@
+/**
+ * Command line tool which emits the synthetic frames of the
+ * SpektrumLoadGenerator to soak test receivers and gateways on a Linux or
+ * macOS host.
+ *
+ * Outputs:
+ * - pty: a pseudo terminal in raw mode: the name of the device is printed, so
+ *   that a receiver (e.g. a host build of a sketch) can open it like a serial
+ *   port
+ * - udp:host:port: one datagram per frame. With -P ports the frames of the
+ *   satellites are distributed over consecutive ports.
+ * - a file name or - for stdout
+ *
+ * The frames are sent at the planned time of the generator (period and
+ * jitter), files are written as fast as possible. At the end (or after
+ * Ctrl-C) the number of frames, the injected faults, the throughput and the
+ * maximum delay behind the schedule are reported.
+ *
+ * Build on Linux or macOS with make: we use the Arduino.h of the
+ * SpektrumConverter.
+ *
+ * Usage: spektrum-load [options] <pty|udp:host:port|file|->
+ *   -n satellites   number of virtual satellites (default 1)
+ *   -c frames       frames per satellite (default 0: until Ctrl-C)
+ *   -b bindmode     BindMode 3-10 which defines the system and header
+ *                   (default 9: Internal_DSMx_11ms)
+ *   -p period       frame period in us (default: from the system)
+ *   -J jitter       maximum jitter in us (default 0)
+ *   -a frames       aux frame after the indicated main frames (default 1)
+ *   -f d,b,t        dropped bytes, bit flips and truncated frames per 1000
+ *                   frames (default 0,0,0)
+ *   -s seed         seed of the frames (default 1)
+ *   -P ports        number of UDP ports (default 1)
+ *   -x              no pacing: send as fast as possible
+ * @author Phil Schatzmann
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "Arduino.h"
+#include "SpektrumLoadGenerator.h"
+
+enum Output { File, Pty, UDP };
+
+static volatile sig_atomic_t isStopped = 0;
+
+static void stop(int signal) { isStopped = 1; }
+
+static void usage() {
+  fprintf(stderr,
+          "Usage: spektrum-load [-n satellites] [-c frames] [-b bindmode] "
+          "[-p period] [-J jitter] [-a frames] [-f drop,flip,truncate] "
+          "[-s seed] [-P ports] [-x] <pty|udp:host:port|file|->\n");
+}
+
+// Opens a pseudo terminal in raw mode: we keep the slave open, so that the
+// writes do not fail before a receiver has connected
+static int openPty(int& slave) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    perror("posix_openpt");
+    return -1;
+  }
+  const char* name = ptsname(master);
+  slave = open(name, O_RDWR | O_NOCTTY);
+  if (slave < 0) {
+    perror(name);
+    return -1;
+  }
+  struct termios settings;
+  tcgetattr(slave, &settings);
+  cfmakeraw(&settings);
+  tcsetattr(slave, TCSANOW, &settings);
+  // a receiver which does not read must not block the generator
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+  fprintf(stderr, "pty: %s\n", name);
+  return master;
+}
+
+// Opens an UDP socket and resolves host:port
+static int openUDP(const std::string& address, sockaddr_in& target) {
+  size_t colon = address.rfind(':');
+  if (colon == std::string::npos) return -1;
+  std::string host = address.substr(0, colon);
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  addrinfo* result;
+  if (getaddrinfo(host.c_str(), address.c_str() + colon + 1, &hints,
+                  &result) != 0) {
+    fprintf(stderr, "invalid address: %s\n", address.c_str());
+    return -1;
+  }
+  target = *(sockaddr_in*)result->ai_addr;
+  freeaddrinfo(result);
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) perror("socket");
+  return fd;
+}
+
+int main(int argc, char* argv[]) {
+  long satellites = 1, frames = 0, ports = 1, auxInterleave = 1;
+  long bindMode = Internal_DSMx_11ms, period = 0, jitter = 0;
+  unsigned long seed = 1;
+  unsigned dropRate = 0, bitFlipRate = 0, truncateRate = 0;
+  bool isPaced = true;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:c:b:p:J:a:f:s:P:x")) != -1) {
+    switch (opt) {
+      case 'n':
+        satellites = atol(optarg);
+        break;
+      case 'c':
+        frames = atol(optarg);
+        break;
+      case 'b':
+        bindMode = atol(optarg);
+        break;
+      case 'p':
+        period = atol(optarg);
+        break;
+      case 'J':
+        jitter = atol(optarg);
+        break;
+      case 'a':
+        auxInterleave = atol(optarg);
+        break;
+      case 'f':
+        if (sscanf(optarg, "%u,%u,%u", &dropRate, &bitFlipRate,
+                   &truncateRate) != 3) {
+          usage();
+          return 1;
+        }
+        break;
+      case 's':
+        seed = strtoul(optarg, NULL, 10);
+        break;
+      case 'P':
+        ports = atol(optarg);
+        break;
+      case 'x':
+        isPaced = false;
+        break;
+      default:
+        usage();
+        return 1;
+    }
+  }
+  if (optind + 1 != argc || satellites < 1 || satellites > 0xFFFF ||
+      bindMode < Internal_DSM2_22ms || bindMode > External_DSMx_11ms ||
+      auxInterleave < 0 || auxInterleave > 255 || ports < 1) {
+    usage();
+    return 1;
+  }
+
+  // open the output
+  std::string name = argv[optind];
+  Output output = name == "pty" ? Pty
+                  : name.compare(0, 4, "udp:") == 0 ? UDP
+                                                    : File;
+  int fd, slave = -1;
+  sockaddr_in target = {};
+  if (output == Pty) {
+    fd = openPty(slave);
+  } else if (output == UDP) {
+    fd = openUDP(name.substr(4), target);
+  } else {
+    // files are written as fast as possible
+    isPaced = false;
+    fd = name == "-" ? STDOUT_FILENO
+                     : open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) perror(name.c_str());
+  }
+  if (fd < 0) return 1;
+
+  SpektrumLoadGenerator generator(seed);
+  generator.setBindingMode((BindMode)bindMode);
+  generator.setPeriod(period > 0 ? period : generator.getPeriod(), jitter);
+  generator.setAuxInterleave(auxInterleave);
+  generator.setSatellites(satellites);
+  generator.setFaults(dropRate, bitFlipRate, truncateRate);
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+  uint16_t basePort = ntohs(target.sin_port);
+  uint8_t frame[SEND_BUFFER_SIZE];
+  unsigned long bytes = 0, overruns = 0;
+  int64_t maxDelay = 0;
+  uint64_t start = micros();
+  bool isError = false;
+  for (uint32_t frameNumber = 0;
+       !isStopped && !isError && (frames == 0 || frameNumber < (uint32_t)frames);
+       frameNumber++) {
+    for (long satellite = 0; satellite < satellites && !isStopped;
+         satellite++) {
+      size_t len = generator.generate(satellite, frameNumber, frame);
+
+      // wait for the planned time of the frame
+      if (isPaced) {
+        int64_t wait = (int64_t)(start +
+                                 generator.getFrameTimeUs(satellite,
+                                                          frameNumber) -
+                                 micros());
+        if (wait > 0) {
+          delayMicroseconds(wait);
+        } else if (-wait > maxDelay) {
+          maxDelay = -wait;
+        }
+      }
+
+      ssize_t written;
+      if (output == UDP) {
+        target.sin_port = htons(basePort + satellite % ports);
+        written =
+            sendto(fd, frame, len, 0, (sockaddr*)&target, sizeof(target));
+      } else {
+        written = write(fd, frame, len);
+      }
+      if (written < 0 && errno != EAGAIN && errno != ENOBUFS) {
+        perror("write");
+        isError = true;
+        break;
+      }
+      if (written < (ssize_t)len) overruns++;
+      if (written > 0) bytes += written;
+    }
+  }
+
+  double seconds = (micros() - start) / 1000000.0;
+  unsigned long count = generator.getFrameCount();
+  fprintf(stderr,
+          "%lu frames, %lu bytes in %.2f s (%.0f frames/s), dropped bytes: "
+          "%lu, bit flips: %lu, truncated: %lu, overruns: %lu, max delay: "
+          "%ld us\n",
+          count, bytes, seconds, seconds > 0 ? count / seconds : 0.0,
+          generator.getDroppedBytes(), generator.getBitFlips(),
+          generator.getTruncatedFrames(), overruns, (long)maxDelay);
+  if (slave >= 0) {
+    // closing the master discards the data which was not read yet
+    int pending;
+    for (int j = 0; j < 100 && ioctl(slave, FIONREAD, &pending) == 0 &&
+                    pending > 0;
+         j++) {
+      delay(10);
+    }
+    close(slave);
+  }
+  if (fd != STDOUT_FILENO) close(fd);
+  return isError ? 1 : 0;
+}
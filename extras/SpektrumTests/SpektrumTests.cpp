@@ -0,0 +1,19 @@
+/**
+ * Host build of the Tests example on Linux or macOS: we use the Arduino.h of
+ * the SpektrumConverter, so that the tests which need threads (snapshot), a
+ * second process (shared memory) or the sizes of a 64 bit host (footprint)
+ * are executed as well.
+ *
+ * Build and run with make check: it fails if a test reports an Error
+ * @author Phil Schatzmann
+ */
+
+#include "Arduino.h"
+
+#include "../../examples/Tests/Tests.ino"
+
+int main() {
+  setup();
+  Serial.flush();
+  return 0;
+}
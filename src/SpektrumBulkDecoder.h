@@ -0,0 +1,263 @@
+/**
+ * Decoding of many recorded frames at once (e.g. for the offline analysis of
+ * captures). The result is stored column by column: one array per channel
+ * plus the fades and the system byte of each frame.
+ *
+ * The result is identical to calling SpektrumSatellite::parseFrame() for each
+ * frame and recording getChannelValuesRaw() after each call: a frame only
+ * updates the channels which it contains, so all other channels keep the
+ * value of the previous frame. The channel map, the reversed channels and the
+ * byte order are taken over from the satellite with begin().
+ *
+ * The byte swap, mask and shift of the channel words is done with SIMD
+ * instructions (AVX2, SSE2 or NEON) if the compiler supports them. Otherwise
+ * we use the scalar implementation. Carrying the channel values from frame to
+ * frame is serial: we do it without branches and collect the values of
+ * SPEKTRUM_BULK_BLOCK frames, so that each column is written with one copy per
+ * block.
+ * @author Phil Schatzmann
+ */
+
+#pragma once
+
+#include "SpektrumSatellite.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#include <arm_neon.h>
+#define SPEKTRUM_BULK_NEON
+#endif
+
+// Number of frames which are decoded before the channel values are copied to
+// the columns
+// 6 bits for the channel id of a 1024 frame
+#define BULK_MAX_IDS 64
+#ifndef SPEKTRUM_BULK_BLOCK
+#define SPEKTRUM_BULK_BLOCK 8
+#endif
+
+// Output of SpektrumBulkDecoder: each array needs space for count entries
+struct SpektrumColumns {
+  uint16_t* channels[MAX_CHANNELS];
+  uint16_t* fades;
+  uint8_t* system;
+};
+
+/**
+ * @brief Decodes an array of 16 byte frames into SpektrumColumns
+ * @author Phil Schatzmann
+ */
+class SpektrumBulkDecoder {
+ public:
+  SpektrumBulkDecoder(System system = DSMX_11MS_2048, bool isInternal = true) {
+    this->isInternalFlag = isInternal;
+    setSystem(system);
+    memset(channelValues, 0, sizeof(channelValues));
+    memset(reversed, 0, sizeof(reversed));
+    for (int id = 0; id < BULK_MAX_IDS; id++) {
+      targets[id] = id < MAX_CHANNELS ? id : MAX_CHANNELS;
+    }
+  }
+
+  // Takes over the system, mode, byte order, channel map and the current
+  // channel values
+  template <class T, int Options>
+  void begin(SpektrumSatellite<T, Options>& satellite) {
+    this->isInternalFlag = satellite.isInternal();
+    this->isSystemReported = satellite.isSystemReceived();
+    this->isBigEndian = satellite.isBigEndianData();
+    setSystem(satellite.getSystem());
+    memcpy(channelValues, satellite.getChannelValuesRaw(),
+           MAX_CHANNELS * sizeof(uint16_t));
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      targets[ch] = satellite.getChannelPosition((Channel)ch);
+      reversed[ch] = satellite.isChannelReversed((Channel)ch) ? 0xFFFF : 0;
+    }
+  }
+
+  void setSystem(System system) {
+    this->system = system;
+    if (system == DSM2_22MS_1024) {
+      maskCHANID = MASK_1024_CHANID;
+      maskVALUE = MASK_1024_SXPOS;
+      channelShift = 10;
+    } else {
+      maskCHANID = MASK_2048_CHANID;
+      maskVALUE = MASK_2048_SXPOS;
+      channelShift = 11;
+    }
+  }
+
+  System getSystem() { return system; }
+
+  // Provides the channel values after the last decoded frame
+  uint16_t* getChannelValuesRaw() { return channelValues; }
+
+  // Name of the used implementation
+  const char* getImplementation() {
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE2";
+#elif defined(SPEKTRUM_BULK_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+  }
+
+  // Decodes count frames of SEND_BUFFER_SIZE bytes
+  void decode(const uint8_t* frames, size_t count, SpektrumColumns& out) {
+    if (count > 0) {
+      // like parseFrame we take over the system of the first frame
+      updateSystem(frames);
+    }
+    for (size_t base = 0; base < count; base += SPEKTRUM_BULK_BLOCK) {
+      size_t n = count - base < SPEKTRUM_BULK_BLOCK ? count - base
+                                                    : SPEKTRUM_BULK_BLOCK;
+      decodeBlock(frames + base * SEND_BUFFER_SIZE, n);
+      storeBlock(frames + base * SEND_BUFFER_SIZE, base, n, out);
+    }
+  }
+
+  // Decodes a single frame without SIMD instructions
+  void decodeScalar(const uint8_t* frame, size_t index, SpektrumColumns& out) {
+    updateSystem(frame);
+    uint16_t ids[8], values[8];
+    decodeWords(frame, ids, values);
+    apply(ids, values, 0);
+    storeBlock(frame, index, 1, out);
+  }
+
+ private:
+  // the last entry receives the values of the invalid channel ids
+  uint16_t channelValues[MAX_CHANNELS + 1];
+  // position and xor mask for each possible channel id
+  uint8_t targets[BULK_MAX_IDS];
+  uint16_t reversed[BULK_MAX_IDS];
+  uint16_t maskCHANID;
+  uint16_t maskVALUE;
+  uint8_t channelShift;
+  System system;
+  bool isInternalFlag;
+  bool isSystemReported = false;
+  bool isBigEndian = true;
+  // channel values of the frames of a block: stored column by column
+  uint16_t block[MAX_CHANNELS][SPEKTRUM_BULK_BLOCK];
+
+  void updateSystem(const uint8_t* frame) {
+    if (isInternalFlag && !isSystemReported) {
+      isSystemReported = true;
+      int received = frame[1];
+      if (received == DSM2_22MS_1024 || received == DSM2_11MS_2048 ||
+          received == DSMS_22MS_2048 || received == DSMX_11MS_2048) {
+        setSystem((System)received);
+      }
+    }
+  }
+
+  // Decodes the words of n <= SPEKTRUM_BULK_BLOCK frames into the block
+  void decodeBlock(const uint8_t* frames, size_t n) {
+    size_t f = 0;
+#if defined(__AVX2__)
+    const __m256i maskId = _mm256_set1_epi16(maskCHANID);
+    const __m256i maskValue = _mm256_set1_epi16(maskVALUE);
+    const __m128i shift = _mm_cvtsi32_si128(channelShift);
+    for (; f + 2 <= n; f += 2) {
+      __m256i words =
+          _mm256_loadu_si256((const __m256i*)(frames + f * SEND_BUFFER_SIZE));
+      if (isBigEndian) {
+        words = _mm256_or_si256(_mm256_slli_epi16(words, 8),
+                                _mm256_srli_epi16(words, 8));
+      }
+      uint16_t ids[16], values[16];
+      _mm256_storeu_si256((__m256i*)ids,
+                          _mm256_srl_epi16(_mm256_and_si256(words, maskId),
+                                           shift));
+      _mm256_storeu_si256((__m256i*)values,
+                          _mm256_and_si256(words, maskValue));
+      apply(ids, values, f);
+      apply(ids + 8, values + 8, f + 1);
+    }
+#elif defined(__SSE2__)
+    const __m128i maskId = _mm_set1_epi16(maskCHANID);
+    const __m128i maskValue = _mm_set1_epi16(maskVALUE);
+    const __m128i shift = _mm_cvtsi32_si128(channelShift);
+    for (; f < n; f++) {
+      __m128i words =
+          _mm_loadu_si128((const __m128i*)(frames + f * SEND_BUFFER_SIZE));
+      if (isBigEndian) {
+        words =
+            _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+      }
+      uint16_t ids[8], values[8];
+      _mm_storeu_si128((__m128i*)ids,
+                       _mm_srl_epi16(_mm_and_si128(words, maskId), shift));
+      _mm_storeu_si128((__m128i*)values, _mm_and_si128(words, maskValue));
+      apply(ids, values, f);
+    }
+#elif defined(SPEKTRUM_BULK_NEON)
+    const uint16x8_t maskId = vdupq_n_u16(maskCHANID);
+    const uint16x8_t maskValue = vdupq_n_u16(maskVALUE);
+    const int16x8_t shift = vdupq_n_s16(-(int16_t)channelShift);
+    for (; f < n; f++) {
+      uint8x16_t bytes = vld1q_u8(frames + f * SEND_BUFFER_SIZE);
+      if (isBigEndian) bytes = vrev16q_u8(bytes);
+      uint16x8_t words = vreinterpretq_u16_u8(bytes);
+      uint16_t ids[8], values[8];
+      vst1q_u16(ids, vshlq_u16(vandq_u16(words, maskId), shift));
+      vst1q_u16(values, vandq_u16(words, maskValue));
+      apply(ids, values, f);
+    }
+#endif
+    for (; f < n; f++) {
+      uint16_t ids[8], values[8];
+      decodeWords(frames + f * SEND_BUFFER_SIZE, ids, values);
+      apply(ids, values, f);
+    }
+  }
+
+  // Splits the words 1..7 of a frame into the channel ids and values
+  void decodeWords(const uint8_t* frame, uint16_t* ids, uint16_t* values) {
+    for (int i = 1; i < 8; i++) {
+      uint16_t word = isBigEndian ? (frame[2 * i] << 8) | frame[2 * i + 1]
+                                  : frame[2 * i] | (frame[2 * i + 1] << 8);
+      ids[i] = (word & maskCHANID) >> channelShift;
+      values[i] = word & maskVALUE;
+    }
+  }
+
+  // Updates the channel values with the words 1..7 and records the result in
+  // the column f of the block
+  void apply(const uint16_t* ids, const uint16_t* values, size_t f) {
+    // no branches: invalid ids are written to the unused last entry
+    for (int i = 1; i < 8; i++) {
+      channelValues[targets[ids[i]]] =
+          values[i] ^ (reversed[ids[i]] & maskVALUE);
+    }
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      block[ch][f] = channelValues[ch];
+    }
+  }
+
+  // Copies the n columns of the block and the header of the frames to the
+  // output starting at index
+  void storeBlock(const uint8_t* frames, size_t index, size_t n,
+                  SpektrumColumns& out) {
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      memcpy(out.channels[ch] + index, block[ch], n * sizeof(uint16_t));
+    }
+    for (size_t f = 0; f < n; f++) {
+      const uint8_t* frame = frames + f * SEND_BUFFER_SIZE;
+      if (isInternalFlag) {
+        out.fades[index + f] = frame[0];
+      } else {
+        uint16_t fades;
+        memcpy(&fades, frame, sizeof(fades));
+        out.fades[index + f] = fades;
+      }
+      out.system[index + f] = frame[1];
+    }
+  }
+};
@@ -0,0 +1,82 @@
+/**
+ * Converts the raw channel values of the SpektrumSatellite into a CPPM (PPM
+ * sum signal) pulse schedule which can be output with a timer.
+ *
+ * Each channel is represented by the time between the start of two separator
+ * pulses (CPPM_PULSE_US): 1000us for the minimum and 2000us for the maximum
+ * value. The last entry of the schedule is the sync gap which fills up the
+ * frame to the frame length. We use integer arithmetic only.
+ *
+ * The sync gap needs at least CPPM_MIN_SYNC_US even if all channels are at
+ * full travel: so the number of channels is limited to (frameUs - 3000) /
+ * 2000, which is 9 channels for the standard 22.5ms frame. 12 channels need
+ * a frame of 27ms.
+ * @author Phil Schatzmann
+ */
+
+#pragma once
+
+#include "SpektrumSatellite.h"
+
+#define CPPM_MAX_CHANNELS MAX_CHANNELS
+#define CPPM_FRAME_US 22500
+#define CPPM_PULSE_US 300
+#define CPPM_MIN_US 1000
+#define CPPM_MAX_US 2000
+#define CPPM_MIN_SYNC_US 3000
+
+/**
+ * @brief CPPM Encoder
+ * @author Phil Schatzmann
+ */
+class SpektrumCPPM {
+ public:
+  // The number of channels is capped to getMaxChannels(frameUs)
+  SpektrumCPPM(uint8_t channels = 8, uint16_t frameUs = CPPM_FRAME_US) {
+    uint8_t max = getMaxChannels(frameUs);
+    this->channels = channels > max ? max : channels;
+    this->frameUs = frameUs;
+  }
+
+  // Number of channels which fit into the frame with the minimum sync gap
+  static uint8_t getMaxChannels(uint16_t frameUs) {
+    if (frameUs < CPPM_MIN_SYNC_US) return 0;
+    long max = (frameUs - CPPM_MIN_SYNC_US) / CPPM_MAX_US;
+    return max > CPPM_MAX_CHANNELS ? CPPM_MAX_CHANNELS : max;
+  }
+
+  int getChannels() { return channels; }
+
+  // Number of entries in the schedule (channels + sync gap)
+  int size() { return channels + 1; }
+
+  template <class T, int Options>
+  uint16_t* encode(SpektrumSatellite<T, Options>& satellite) {
+    return encode(satellite.getChannelValuesRaw(), satellite.is2048());
+  }
+
+  // Determines the slot length in us for each channel followed by the sync
+  // gap
+  uint16_t* encode(const uint16_t* channelValues, bool is2048) {
+    uint8_t shift = is2048 ? 11 : 10;
+    uint16_t total = 0;
+    for (int ch = 0; ch < channels; ch++) {
+      uint16_t slot =
+          CPPM_MIN_US + (((uint32_t)channelValues[ch] *
+                          (CPPM_MAX_US - CPPM_MIN_US)) >> shift);
+      schedule[ch] = slot;
+      total += slot;
+    }
+    // the channels are capped, so the gap is at least CPPM_MIN_SYNC_US
+    schedule[channels] = frameUs - total;
+    return schedule;
+  }
+
+  // Provides the last encoded schedule
+  uint16_t* getSchedule() { return schedule; }
+
+ private:
+  uint16_t schedule[CPPM_MAX_CHANNELS + 1];
+  uint8_t channels;
+  uint16_t frameUs;
+};
@@ -10,13 +10,18 @@ template <class T>
 class SpektrumCSV {
     public:
         SpektrumCSV(char delimiter=',',int decimals=2, bool isTranslated=true);
-        void toString(SpektrumSatellite<T> &satellite, uint8_t dataSting[], uint16_t maxLen);
-        bool parse(uint8_t* str, SpektrumSatellite<T> &satellite);
+        template <int Options>
+        void toString(SpektrumSatellite<T, Options> &satellite, uint8_t dataSting[], uint16_t maxLen);
+        // Converts MAX_CHANNELS raw values (e.g. of a SpektrumSnapshot)
+        void toString(const uint16_t* channelValues, uint8_t dataSting[], uint16_t maxLen);
+        template <int Options>
+        bool parse(uint8_t* str, SpektrumSatellite<T, Options> &satellite);
         void setFactor(double factor);
     private:
       char delimiter;
       bool isTranslated;
       char* findEnd(char* start);
+      char* append(char* start, float value, int channel);
       char format[15];
 };
 
@@ -36,27 +41,51 @@ SpektrumCSV<T>::SpektrumCSV(char delimiter,int decimals, bool isTranslated){
  * Convert to tab seperated values
  */
 template <class T>
-void SpektrumCSV<T>::toString(SpektrumSatellite<T> &satellite, uint8_t str[], uint16_t len) {
-    uint8_t* start = str;
+template <int Options>
+void SpektrumCSV<T>::toString(SpektrumSatellite<T, Options> &satellite, uint8_t str[], uint16_t len) {
+    char* start = (char*) str;
     for (int j=0; j < MAX_CHANNELS; j++){
         float val = isTranslated ?  satellite.getChannelValue((Channel)j): satellite.getChannelValuesRaw()[(Channel)j];
-        int len = sprintf((char*)start, format, val);
-        start+=len;
-        if (j<MAX_CHANNELS-1){
-            *start = delimiter;
-            start++;
-        }
+        start = append(start, val, j);
+    }
+}
+
+/**
+ * Convert raw values to tab seperated values
+ */
+template <class T>
+void SpektrumCSV<T>::toString(const uint16_t* channelValues, uint8_t str[], uint16_t len) {
+    char* start = (char*) str;
+    for (int j=0; j < MAX_CHANNELS; j++){
+        start = append(start, channelValues[j], j);
+    }
+}
+
+/**
+ * Formats the value followed by the delimiter or by the end of the line
+ */
+template <class T>
+char* SpektrumCSV<T>::append(char* start, float value, int channel) {
+    start += sprintf(start, format, value);
+    if (channel<MAX_CHANNELS-1){
+        *start = delimiter;
+        start++;
+    } else {
+        sprintf(start,"\n");
     }
-    sprintf((char*)start,"\n");
+    return start;
 }
 
 /**
  * Parse tab seperated values
  */
 template <class T>
-bool SpektrumCSV<T>::parse(uint8_t* str, SpektrumSatellite<T> &satellite){
+template <int Options>
+bool SpektrumCSV<T>::parse(uint8_t* str, SpektrumSatellite<T, Options> &satellite){
     bool result = false;
     char* start = (char*)str;
+    // readSnapshot() sees all channels of the line as one update
+    satellite.beginUpdate();
     for (int j=0; j< MAX_CHANNELS; j++){
         Channel ch = (Channel) j;
         char* end = findEnd(start);
@@ -72,6 +101,7 @@ bool SpektrumCSV<T>::parse(uint8_t* str, SpektrumSatellite<T> &satellite){
         }
         start = end+1;
     }
+    satellite.endUpdate();
     return result;
 }
 
@@ -0,0 +1,182 @@
+/**
+ * Change driven publishing of the channel values: most of the time most sticks
+ * do not move, so instead of sending all 12 channels with each frame we only
+ * send the channels which have changed by more than a per channel hysteresis.
+ *
+ * A packet consists of the type (DELTA_KEYFRAME or DELTA_UPDATE), a sequence
+ * number, the number of channels and for each channel a big endian word with
+ * the channel id in the upper 5 bits and the raw value in the lower 11 bits
+ * (like in a 2048 Spektrum frame). A keyframe with all channels is sent every
+ * DELTA_KEYFRAME_INTERVAL frames, so that a receiver can resynchronize after a
+ * lost packet.
+ * @author Phil Schatzmann
+ */
+
+#pragma once
+
+#include "SpektrumSatellite.h"
+
+#define DELTA_KEYFRAME 'K'
+#define DELTA_UPDATE 'D'
+#define DELTA_HEADER_SIZE 3
+#define DELTA_MAX_PACKET_SIZE (DELTA_HEADER_SIZE + 2 * MAX_CHANNELS)
+#define DELTA_KEYFRAME_INTERVAL 50
+#define DELTA_VALUE_MASK 0x07FF
+
+/**
+ * @brief Determines the changed channels and encodes them into a packet
+ * @author Phil Schatzmann
+ */
+class SpektrumDeltaPublisher {
+ public:
+  // Sends a keyframe every keyframeInterval frames (0 = only the first one)
+  SpektrumDeltaPublisher(uint16_t keyframeInterval = DELTA_KEYFRAME_INTERVAL) {
+    this->keyframeInterval = keyframeInterval;
+    setHysteresis(0);
+    requestKeyframe();
+  }
+
+  // A channel is only sent if it differs by more than the indicated raw value
+  // from the last sent value
+  void setHysteresis(Channel channelId, uint16_t rawDelta) {
+    if (channelId >= Throttle && channelId <= Aux7) {
+      hysteresis[channelId] = rawDelta;
+    }
+  }
+
+  // Defines the same hysteresis for all channels
+  void setHysteresis(uint16_t rawDelta) {
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) hysteresis[ch] = rawDelta;
+  }
+
+  void setKeyframeInterval(uint16_t frames) { keyframeInterval = frames; }
+
+  // The next packet will be a keyframe (e.g. when a new receiver connects)
+  void requestKeyframe() { keyframeRequested = true; }
+
+  // Encodes the next packet: returns its length or 0 if nothing has changed
+  template <class T, int Options>
+  size_t encode(SpektrumSatellite<T, Options>& satellite) {
+    SpektrumSnapshot snapshot;
+    satellite.readSnapshot(snapshot);
+    return encode(snapshot.channelValues);
+  }
+
+  // Encodes the next packet from MAX_CHANNELS raw values
+  size_t encode(const uint16_t* channelValues) {
+    bool isKeyframe =
+        keyframeRequested ||
+        (keyframeInterval > 0 && framesSinceKeyframe >= keyframeInterval);
+    int count = 0;
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      uint16_t value = channelValues[ch] & DELTA_VALUE_MASK;
+      uint16_t diff = value > lastSent[ch] ? value - lastSent[ch]
+                                           : lastSent[ch] - value;
+      if (isKeyframe || diff > hysteresis[ch]) {
+        lastSent[ch] = value;
+        uint16_t word = (ch << 11) | value;
+        packet[DELTA_HEADER_SIZE + 2 * count] = word >> 8;
+        packet[DELTA_HEADER_SIZE + 2 * count + 1] = word & 0xFF;
+        count++;
+      }
+    }
+    if (isKeyframe) {
+      keyframeRequested = false;
+      framesSinceKeyframe = 0;
+    }
+    framesSinceKeyframe++;
+    if (count == 0) {
+      packetSize = 0;
+      return 0;
+    }
+    packet[0] = isKeyframe ? DELTA_KEYFRAME : DELTA_UPDATE;
+    packet[1] = sequence++;
+    packet[2] = count;
+    packetSize = DELTA_HEADER_SIZE + 2 * count;
+    return packetSize;
+  }
+
+  // Encodes the next packet and writes it: returns the number of bytes
+  template <class T, int Options>
+  size_t publish(SpektrumSatellite<T, Options>& satellite, Print& out) {
+    size_t len = encode(satellite);
+    return len > 0 ? out.write(packet, len) : 0;
+  }
+
+  // Provides the last encoded packet
+  uint8_t* getPacket() { return packet; }
+
+  size_t getPacketSize() { return packetSize; }
+
+ private:
+  uint8_t packet[DELTA_MAX_PACKET_SIZE];
+  size_t packetSize = 0;
+  uint16_t lastSent[MAX_CHANNELS] = {0};
+  uint16_t hysteresis[MAX_CHANNELS];
+  uint16_t keyframeInterval;
+  uint16_t framesSinceKeyframe = 0;
+  bool keyframeRequested;
+  uint8_t sequence = 0;
+};
+
+/**
+ * @brief Applies the packets of a SpektrumDeltaPublisher to a
+ * SpektrumSatellite
+ * @author Phil Schatzmann
+ */
+class SpektrumDeltaReceiver {
+ public:
+  // Updates the channel values of the satellite: returns false if the packet
+  // is invalid (e.g. a channel id >= 12)
+  template <class T, int Options>
+  bool apply(const uint8_t* data, size_t len,
+             SpektrumSatellite<T, Options>& satellite) {
+    if (len < DELTA_HEADER_SIZE ||
+        (data[0] != DELTA_KEYFRAME && data[0] != DELTA_UPDATE) ||
+        data[2] > MAX_CHANNELS || len != DELTA_HEADER_SIZE + 2 * data[2]) {
+      invalidPackets++;
+      return false;
+    }
+    // we validate all channel ids before we change anything
+    for (int j = 0; j < data[2]; j++) {
+      if ((data[DELTA_HEADER_SIZE + 2 * j] >> 3) >= MAX_CHANNELS) {
+        invalidPackets++;
+        return false;
+      }
+    }
+
+    // a missing sequence number means that we might have missed changes
+    if (hasSequence && data[1] != (uint8_t)(lastSequence + 1)) {
+      lostPackets += (uint8_t)(data[1] - lastSequence - 1);
+      synchronized = false;
+    }
+    hasSequence = true;
+    lastSequence = data[1];
+    if (data[0] == DELTA_KEYFRAME) synchronized = true;
+
+    // readSnapshot() sees all channels of the packet as one update
+    satellite.beginUpdate();
+    for (int j = 0; j < data[2]; j++) {
+      uint16_t word = (data[DELTA_HEADER_SIZE + 2 * j] << 8) |
+                      data[DELTA_HEADER_SIZE + 2 * j + 1];
+      satellite.setChannelValueRaw((Channel)(word >> 11),
+                                   word & DELTA_VALUE_MASK);
+    }
+    satellite.endUpdate();
+    return true;
+  }
+
+  // False from a lost packet until the next keyframe
+  bool isSynchronized() { return synchronized; }
+
+  unsigned long getLostPackets() { return lostPackets; }
+
+  unsigned long getInvalidPackets() { return invalidPackets; }
+
+ private:
+  bool synchronized = false;
+  bool hasSequence = false;
+  uint8_t lastSequence = 0;
+  unsigned long lostPackets = 0;
+  unsigned long invalidPackets = 0;
+};
@@ -0,0 +1,223 @@
+/**
+ * Generates synthetic Spektrum frames to stress test receivers and gateways:
+ * the frames are encoded with setChannelValueRaw() and getSendBuffer() of a
+ * SpektrumSatellite for any System and BindMode. The frames can be written to
+ * any Print (e.g. a SpektrumMemoryStream, a Serial or WiFiUDP).
+ *
+ * The sticks of each virtual satellite move with a different speed and phase
+ * (triangle wave). Faults (dropped bytes, bit flips and truncated frames) are
+ * injected with the defined rates. The frames are derived from the seed, the
+ * satellite number and the frame number only: so we can simulate thousands of
+ * virtual satellites without any memory per satellite and reproduce each
+ * frame.
+ * @author Phil Schatzmann
+ */
+
+#pragma once
+
+#include "SpektrumMemoryStream.h"
+#include "SpektrumSatellite.h"
+
+#define LOAD_MAX_SPEED 16
+
+/**
+ * @brief Synthetic frame generator with fault injection
+ * @author Phil Schatzmann
+ */
+class SpektrumLoadGenerator {
+ public:
+  SpektrumLoadGenerator(uint32_t seed = 1) : stream(NULL, 0), encoder(stream) {
+    this->seed = seed;
+    setBindingMode(Internal_DSMx_11ms);
+  }
+
+  // Defines the system: this also sets the period to 11ms or 22ms
+  void setSystem(System system) {
+    encoder.setSystem(system);
+    unsigned long period =
+        (system == DSM2_22MS_1024 || system == DSMS_22MS_2048) ? 22000 : 11000;
+    setPeriod(period, jitterUs);
+  }
+
+  // Internal bind modes send the system in the header: this also sets the
+  // matching system
+  void setBindingMode(BindMode bindMode) {
+    encoder.setBindingMode(bindMode);
+    setSystem(encoder.getSystem());
+  }
+
+  // Time between the frames of a satellite and the maximum deviation (less
+  // than half of the period)
+  void setPeriod(unsigned long periodUs, unsigned long jitterUs = 0) {
+    this->periodUs = periodUs;
+    this->jitterUs = jitterUs < periodUs / 2 ? jitterUs : periodUs / 2;
+  }
+
+  unsigned long getPeriod() { return periodUs; }
+
+  // An aux frame is sent after the indicated number of main frames (0: no aux
+  // frames)
+  void setAuxInterleave(uint8_t mainFrames) { auxInterleave = mainFrames; }
+
+  // Number of virtual satellites which are served round robin by next()
+  void setSatellites(uint16_t count) { satellites = count > 0 ? count : 1; }
+
+  // Fault rates in frames per 1000 frames
+  void setFaults(uint16_t dropRate, uint16_t bitFlipRate,
+                 uint16_t truncateRate) {
+    this->dropRate = dropRate;
+    this->bitFlipRate = bitFlipRate;
+    this->truncateRate = truncateRate;
+  }
+
+  // Writes the indicated frame (with the faults) to out (SEND_BUFFER_SIZE
+  // bytes): returns the number of bytes
+  size_t generate(uint16_t satellite, uint32_t frameNumber, uint8_t* out) {
+    bool aux = isAuxFrame(frameNumber);
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      encoder.setChannelValueRaw((Channel)ch,
+                                 getValue(satellite, (Channel)ch, frameNumber));
+    }
+    memcpy(out, encoder.getSendBuffer(aux), SEND_BUFFER_SIZE);
+    frameCount++;
+    return injectFaults(satellite, frameNumber, out);
+  }
+
+  // Generates the next frame of the next satellite
+  size_t next(uint8_t* out) {
+    lastSatellite = nextSatellite;
+    lastFrameNumber = nextFrameNumber;
+    if (++nextSatellite >= satellites) {
+      nextSatellite = 0;
+      nextFrameNumber++;
+    }
+    return generate(lastSatellite, lastFrameNumber, out);
+  }
+
+  // Writes the next frame: returns the number of bytes
+  size_t write(Print& out) {
+    uint8_t frame[SEND_BUFFER_SIZE];
+    size_t len = next(frame);
+    return len > 0 ? out.write(frame, len) : 0;
+  }
+
+  // Satellite of the last frame of next()
+  uint16_t getSatellite() { return lastSatellite; }
+
+  // Frame number of the last frame of next()
+  uint32_t getFrameNumber() { return lastFrameNumber; }
+
+  bool isAuxFrame(uint32_t frameNumber) {
+    return auxInterleave > 0 &&
+           frameNumber % (auxInterleave + 1) == auxInterleave;
+  }
+
+  // Raw value which is sent for the channel in the indicated frame
+  uint16_t getValue(uint16_t satellite, Channel channelId,
+                    uint32_t frameNumber) {
+    uint32_t range = encoder.is2048() ? 2048 : 1024;
+    uint32_t random = hash(satellite, channelId, 0);
+    uint32_t speed = 1 + random % LOAD_MAX_SPEED;
+    uint32_t position = (random / LOAD_MAX_SPEED + speed * frameNumber) %
+                        (2 * range);
+    return position < range ? position : 2 * range - 1 - position;
+  }
+
+  // Channel values of a receiver which has received all frames up to the
+  // indicated frame without faults (starting with 0)
+  void getExpectedValues(uint16_t satellite, uint32_t frameNumber,
+                         uint16_t* values) {
+    // the main frame contains the channels 0-6, the aux frame 6-11
+    bool hasAux = auxInterleave > 0 && frameNumber >= auxInterleave;
+    uint32_t lastAux = frameNumber - (frameNumber + 1) % (auxInterleave + 1);
+    uint32_t lastMain = isAuxFrame(frameNumber) ? frameNumber - 1 : frameNumber;
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      if (ch < Aux2 || (ch == Aux2 && !(hasAux && lastAux > lastMain))) {
+        values[ch] = getValue(satellite, (Channel)ch, lastMain);
+      } else if (hasAux) {
+        values[ch] = getValue(satellite, (Channel)ch, lastAux);
+      } else {
+        values[ch] = 0;
+      }
+    }
+    // the unused 7th word of an aux frame is 0, which decodes as Throttle
+    if (isAuxFrame(frameNumber)) values[Throttle] = 0;
+  }
+
+  // Planned send time of the frame in us (from the start): 64 bits, so that
+  // it does not overflow after 71 minutes
+  uint64_t getFrameTimeUs(uint16_t satellite, uint32_t frameNumber) {
+    uint64_t time = (uint64_t)frameNumber * periodUs;
+    if (jitterUs == 0) return time;
+    long jitter =
+        (long)(hash(satellite, frameNumber, 1) % (2 * jitterUs + 1)) -
+        (long)jitterUs;
+    // the first frame can not be sent before the start
+    return jitter < 0 && (uint64_t)-jitter > time ? 0 : time + jitter;
+  }
+
+  unsigned long getFrameCount() { return frameCount; }
+
+  unsigned long getDroppedBytes() { return droppedBytes; }
+
+  unsigned long getBitFlips() { return bitFlips; }
+
+  unsigned long getTruncatedFrames() { return truncatedFrames; }
+
+ private:
+  SpektrumMemoryStream stream;
+  SpektrumSatellite<uint16_t, SpektrumSendOnly | SpektrumNoScaler |
+                                  SpektrumNoStats | SpektrumNoLog>
+      encoder;
+  uint32_t seed;
+  unsigned long periodUs;
+  unsigned long jitterUs = 0;
+  uint8_t auxInterleave = 0;
+  uint16_t satellites = 1;
+  uint16_t dropRate = 0;
+  uint16_t bitFlipRate = 0;
+  uint16_t truncateRate = 0;
+  uint16_t nextSatellite = 0;
+  uint32_t nextFrameNumber = 0;
+  uint16_t lastSatellite = 0;
+  uint32_t lastFrameNumber = 0;
+  unsigned long frameCount = 0;
+  unsigned long droppedBytes = 0;
+  unsigned long bitFlips = 0;
+  unsigned long truncatedFrames = 0;
+
+  // Reproducible random number for the combination of the arguments
+  uint32_t hash(uint32_t a, uint32_t b, uint32_t c) {
+    uint32_t h = seed ^ (a * 0x9E3779B1UL) ^ (b * 0x85EBCA77UL) ^
+                 (c * 0xC2B2AE3DUL);
+    h ^= h >> 16;
+    h *= 0x7FEB352DUL;
+    h ^= h >> 15;
+    h *= 0x846CA68BUL;
+    h ^= h >> 16;
+    return h;
+  }
+
+  size_t injectFaults(uint16_t satellite, uint32_t frameNumber, uint8_t* out) {
+    size_t len = SEND_BUFFER_SIZE;
+    uint32_t random = hash(satellite, frameNumber, 2);
+    if (random % 1000 < bitFlipRate) {
+      uint32_t bit = hash(satellite, frameNumber, 3) % (8 * SEND_BUFFER_SIZE);
+      out[bit / 8] ^= 1 << (bit % 8);
+      bitFlips++;
+    }
+    random = hash(satellite, frameNumber, 4);
+    if (random % 1000 < dropRate) {
+      size_t pos = (random / 1000) % len;
+      memmove(out + pos, out + pos + 1, len - pos - 1);
+      len--;
+      droppedBytes++;
+    }
+    random = hash(satellite, frameNumber, 5);
+    if (random % 1000 < truncateRate) {
+      len = 1 + (random / 1000) % (len - 1);
+      truncatedFrames++;
+    }
+    return len;
+  }
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Arduino.h"
+
+/**
+ * A Stream which reads from and writes to a fixed memory buffer. We use it to
+ * replay recorded or generated frames into a SpektrumSatellite (e.g. for
+ * benchmarks and tests) and to capture the data which is sent by sendData().
+ * No memory is allocated: the buffer is provided by the caller.
+ * @author Phil Schatzmann
+ */
+class SpektrumMemoryStream : public Stream {
+ public:
+  SpektrumMemoryStream(uint8_t* buffer, size_t size) {
+    this->buffer = buffer;
+    this->bufferSize = size;
+  }
+
+  // Defines the readable content: the data is copied into the buffer
+  void setData(const uint8_t* data, size_t len) {
+    if (len > bufferSize) len = bufferSize;
+    memcpy(buffer, data, len);
+    readPos = 0;
+    writePos = len;
+  }
+
+  // Makes the current content readable again from the start
+  void rewind() { readPos = 0; }
+
+  // Removes all content
+  void clear() {
+    readPos = 0;
+    writePos = 0;
+  }
+
+  // Number of bytes which have been written
+  size_t size() { return writePos; }
+
+  uint8_t* data() { return buffer; }
+
+  int available() override { return writePos - readPos; }
+
+  int read() override {
+    if (readPos >= writePos) return -1;
+    return buffer[readPos++];
+  }
+
+  int peek() override {
+    if (readPos >= writePos) return -1;
+    return buffer[readPos];
+  }
+
+  size_t write(uint8_t value) override {
+    if (writePos >= bufferSize) return 0;
+    buffer[writePos++] = value;
+    return 1;
+  }
+
+  size_t write(const uint8_t* data, size_t len) override {
+    if (len > bufferSize - writePos) len = bufferSize - writePos;
+    memcpy(buffer + writePos, data, len);
+    writePos += len;
+    return len;
+  }
+
+  void flush() override {}
+
+ private:
+  uint8_t* buffer;
+  size_t bufferSize;
+  size_t readPos = 0;
+  size_t writePos = 0;
+};
@@ -0,0 +1,385 @@
+/**
+ * Compile time composition of the processing of the received frames:
+ *
+ *   source (the Stream of the SpektrumSatellite: Serial, UDP or a replay with
+ *   the SpektrumMemoryStream) -> decode (getFrame()) -> transforms -> sinks
+ *
+ * The decoded data is copied once into a SpektrumSnapshot which is then passed
+ * by reference through all stages: the transforms change the raw channel
+ * values in place and the sinks output them. A stage is any class with a
+ * bool process(SpektrumSnapshot& frame) method: if it returns false the
+ * following stages are skipped. The chain of stages is resolved at compile
+ * time, so there is no virtual dispatch.
+ *
+ * If SPEKTRUM_PROFILE is defined the time which is spent in the source and in
+ * each stage is recorded (see SpektrumProfiler).
+ * @author Phil Schatzmann
+ */
+
+#pragma once
+
+#include "Scaler.h"
+#include "SpektrumCSV.h"
+#include "SpektrumSatellite.h"
+#include "SpektrumSBUS.h"
+
+#define MAX_MIXER_RULES 8
+
+// Maximum raw value of the system of the frame
+inline uint16_t spektrumMaxValue(const SpektrumSnapshot& frame) {
+  return frame.system == DSM2_22MS_1024 ? MASK_1024_SXPOS : MASK_2048_SXPOS;
+}
+
+/**
+ * @brief Recursive chain of stages which is resolved at compile time
+ * @author Phil Schatzmann
+ */
+template <class... Stages>
+class SpektrumStages;
+
+template <>
+class SpektrumStages<> {
+ public:
+  bool process(SpektrumSnapshot& frame, ProfileStatistics* statistics) {
+    return true;
+  }
+};
+
+template <class Stage, class... Rest>
+class SpektrumStages<Stage, Rest...> {
+ public:
+  SpektrumStages(Stage& stage, Rest&... rest) : stage(stage), next(rest...) {}
+
+  bool process(SpektrumSnapshot& frame, ProfileStatistics* statistics) {
+#ifdef SPEKTRUM_PROFILE
+    ProfileTicks start = SpektrumProfiler::ticks();
+    bool result = stage.process(frame);
+    SpektrumProfiler::add(*statistics, SpektrumProfiler::elapsed(start));
+    return result && next.process(frame, statistics + 1);
+#else
+    return stage.process(frame) && next.process(frame, statistics);
+#endif
+  }
+
+ private:
+  Stage& stage;
+  SpektrumStages<Rest...> next;
+};
+
+/**
+ * @brief Receives the frames with a SpektrumSatellite and passes them through
+ * the stages
+ * @author Phil Schatzmann
+ */
+template <class Satellite, class... Stages>
+class SpektrumPipeline {
+ public:
+  SpektrumPipeline(Satellite& satellite, Stages&... stages)
+      : satellite(satellite), stages(stages...) {
+#ifdef SPEKTRUM_PROFILE
+    for (int j = 0; j <= (int)sizeof...(Stages); j++) {
+      SpektrumProfiler::reset(statistics[j]);
+    }
+#endif
+  }
+
+  // Receives the next frame and passes it through all stages: returns true
+  // if a frame was received and no stage has stopped the processing
+  bool process(int timeout = DEFAULT_RECEIVING_TIMEOUT) {
+#ifdef SPEKTRUM_PROFILE
+    ProfileTicks start = SpektrumProfiler::ticks();
+#endif
+    if (!satellite.getFrame(timeout)) return false;
+    satellite.readSnapshot(frame);
+#ifdef SPEKTRUM_PROFILE
+    SpektrumProfiler::add(statistics[0], SpektrumProfiler::elapsed(start));
+#endif
+    return stages.process(frame, stageStatistics());
+  }
+
+  // Passes a frame which was provided by other means (e.g. by the
+  // SpektrumBulkDecoder) through all stages
+  bool process(SpektrumSnapshot& frame) {
+    return stages.process(frame, stageStatistics());
+  }
+
+  // Provides the last processed frame
+  SpektrumSnapshot& getFrame() { return frame; }
+
+  // Number of stages (without the source)
+  int size() { return sizeof...(Stages); }
+
+#ifdef SPEKTRUM_PROFILE
+  // Measured ticks of the source (0) and the stages (1..size())
+  ProfileStatistics& getStatistics(int stage) { return statistics[stage]; }
+
+  // Prints the statistics of the source and of each stage
+  void printTo(Print& out) {
+    char name[16];
+    SpektrumProfiler::printTo(out, "source", statistics[0]);
+    for (int j = 1; j <= (int)sizeof...(Stages); j++) {
+      sprintf(name, "stage %d", j);
+      SpektrumProfiler::printTo(out, name, statistics[j]);
+    }
+  }
+#endif
+
+ private:
+  Satellite& satellite;
+  SpektrumStages<Stages...> stages;
+  SpektrumSnapshot frame;
+#ifdef SPEKTRUM_PROFILE
+  ProfileStatistics statistics[sizeof...(Stages) + 1];
+
+  ProfileStatistics* stageStatistics() { return statistics + 1; }
+#else
+  ProfileStatistics* stageStatistics() { return NULL; }
+#endif
+};
+
+// Creates a pipeline without the need to repeat the types of the stages
+template <class Satellite, class... Stages>
+SpektrumPipeline<Satellite, Stages...> spektrumPipeline(Satellite& satellite,
+                                                        Stages&... stages) {
+  return SpektrumPipeline<Satellite, Stages...>(satellite, stages...);
+}
+
+/**
+ * @brief Transform: exponential low pass filter for the selected channels
+ * @author Phil Schatzmann
+ */
+class SpektrumLowPassFilter {
+ public:
+  // The new value is weighted with 1/2^shift
+  SpektrumLowPassFilter(uint8_t shift = 2, uint16_t channelMask = 0x0FFF) {
+    this->shift = shift;
+    this->channelMask = channelMask;
+  }
+
+  bool process(SpektrumSnapshot& frame) {
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      if (!(channelMask & (1 << ch))) continue;
+      // we keep shift additional bits to avoid rounding errors
+      int32_t input = (int32_t)frame.channelValues[ch] << shift;
+      state[ch] = isStarted ? state[ch] + ((input - state[ch]) >> shift)
+                            : input;
+      frame.channelValues[ch] = state[ch] >> shift;
+    }
+    isStarted = true;
+    return true;
+  }
+
+ private:
+  int32_t state[MAX_CHANNELS];
+  uint16_t channelMask;
+  uint8_t shift;
+  bool isStarted = false;
+};
+
+/**
+ * @brief Transform: maps the full raw range of the selected channels to the
+ * range from min to max (e.g. to limit the servo travel)
+ * @author Phil Schatzmann
+ */
+class SpektrumRangeTransform {
+ public:
+  SpektrumRangeTransform(uint16_t min, uint16_t max,
+                         uint16_t channelMask = 0x0FFF) {
+    this->min = min;
+    this->range = max - min;
+    this->channelMask = channelMask;
+  }
+
+  bool process(SpektrumSnapshot& frame) {
+    uint8_t shift = frame.system == DSM2_22MS_1024 ? 10 : 11;
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      if (channelMask & (1 << ch)) {
+        frame.channelValues[ch] =
+            min + (((uint32_t)frame.channelValues[ch] * range) >> shift);
+      }
+    }
+    return true;
+  }
+
+ private:
+  uint16_t min;
+  uint16_t range;
+  uint16_t channelMask;
+};
+
+/**
+ * @brief Transform: converts the raw values of the selected channels with a
+ * Scaler (e.g. to the range of a servo in us or to undo a calibration)
+ * @author Phil Schatzmann
+ */
+template <class T>
+class SpektrumScalerTransform {
+ public:
+  SpektrumScalerTransform(Scaler<T>& scaler, uint16_t channelMask = 0x0FFF)
+      : scaler(scaler) {
+    this->channelMask = channelMask;
+  }
+
+  bool process(SpektrumSnapshot& frame) {
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      if (!(channelMask & (1 << ch))) continue;
+      // the result must fit into the raw value
+      float value = scaler.scale(frame.channelValues[ch]);
+      if (value < 0) value = 0;
+      if (value > 0xFFFF) value = 0xFFFF;
+      frame.channelValues[ch] = value;
+    }
+    return true;
+  }
+
+ private:
+  Scaler<T>& scaler;
+  uint16_t channelMask;
+};
+
+/**
+ * @brief Transform: the target channels are calculated as weighted sum of
+ * the deviations of the source channels from the center (e.g. for elevons or
+ * a V-tail). All rules use the input values of the frame.
+ * @author Phil Schatzmann
+ */
+class SpektrumMixer {
+ public:
+  // Adds percent of the source deviation to the target: the first rule of a
+  // target replaces its value
+  bool addRule(Channel target, Channel source, int8_t percent) {
+    if (ruleCount >= MAX_MIXER_RULES) return false;
+    rules[ruleCount].target = target;
+    rules[ruleCount].source = source;
+    rules[ruleCount].percent = percent;
+    ruleCount++;
+    return true;
+  }
+
+  bool process(SpektrumSnapshot& frame) {
+    int32_t center = (spektrumMaxValue(frame) + 1) / 2;
+    int32_t sums[MAX_CHANNELS];
+    uint16_t targets = 0;
+    for (int j = 0; j < ruleCount; j++) {
+      Rule& rule = rules[j];
+      if (!(targets & (1 << rule.target))) sums[rule.target] = 0;
+      targets |= 1 << rule.target;
+      sums[rule.target] +=
+          (frame.channelValues[rule.source] - center) * rule.percent;
+    }
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      if (!(targets & (1 << ch))) continue;
+      int32_t value = center + sums[ch] / 100;
+      if (value < 0) value = 0;
+      if (value > spektrumMaxValue(frame)) value = spektrumMaxValue(frame);
+      frame.channelValues[ch] = value;
+    }
+    return true;
+  }
+
+ private:
+  struct Rule {
+    Channel target;
+    Channel source;
+    int8_t percent;
+  } rules[MAX_MIXER_RULES];
+  uint8_t ruleCount = 0;
+};
+
+/**
+ * @brief Sink: sends the frame with a SpektrumSatellite (e.g. via UDP)
+ * @author Phil Schatzmann
+ */
+template <class Satellite>
+class SpektrumSendSink {
+ public:
+  SpektrumSendSink(Satellite& satellite) : satellite(satellite) {}
+
+  bool process(SpektrumSnapshot& frame) {
+    satellite.beginUpdate();
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      satellite.setChannelValueRaw((Channel)ch, frame.channelValues[ch]);
+    }
+    satellite.endUpdate();
+    satellite.sendData();
+    return true;
+  }
+
+ private:
+  Satellite& satellite;
+};
+
+/**
+ * @brief Sink: prints the raw channel values as CSV line with SpektrumCSV
+ * @author Phil Schatzmann
+ */
+class SpektrumCSVSink {
+ public:
+  SpektrumCSVSink(Print& out, char delimiter = ',')
+      : out(out), csv(delimiter, 0, false) {}
+
+  bool process(SpektrumSnapshot& frame) {
+    csv.toString(frame.channelValues, line, sizeof(line));
+    out.print((char*)line);
+    return true;
+  }
+
+ private:
+  Print& out;
+  SpektrumCSV<uint16_t> csv;
+  // 12 values with up to 5 digits, the delimiters and the line end
+  uint8_t line[MAX_CHANNELS * 6 + 2];
+};
+
+/**
+ * @brief Sink: writes the frame as binary SBUS frame
+ * @author Phil Schatzmann
+ */
+class SpektrumSBUSSink {
+ public:
+  SpektrumSBUSSink(Print& out, uint16_t min = SBUS_MIN, uint16_t max = SBUS_MAX)
+      : out(out), sbus(min, max) {}
+
+  bool process(SpektrumSnapshot& frame) {
+    out.write(sbus.encode(frame.channelValues,
+                          frame.system != DSM2_22MS_1024),
+              SBUS_FRAME_SIZE);
+    return true;
+  }
+
+ private:
+  Print& out;
+  SpektrumSBUS sbus;
+};
+
+/**
+ * @brief Sink: updates servos (any class with writeMicroseconds(int)) with the
+ * first channels
+ * @author Phil Schatzmann
+ */
+template <class Servo>
+class SpektrumServoSink {
+ public:
+  SpektrumServoSink(Servo* servos, int count, uint16_t minUs = 1000,
+                    uint16_t maxUs = 2000) {
+    this->servos = servos;
+    this->count = count > MAX_CHANNELS ? MAX_CHANNELS : count;
+    this->minUs = minUs;
+    this->rangeUs = maxUs - minUs;
+  }
+
+  bool process(SpektrumSnapshot& frame) {
+    uint8_t shift = frame.system == DSM2_22MS_1024 ? 10 : 11;
+    for (int ch = 0; ch < count; ch++) {
+      servos[ch].writeMicroseconds(
+          minUs + (((uint32_t)frame.channelValues[ch] * rangeUs) >> shift));
+    }
+    return true;
+  }
+
+ private:
+  Servo* servos;
+  int count;
+  uint16_t minUs;
+  uint16_t rangeUs;
+};
@@ -0,0 +1,184 @@
+/**
+ * Optional instrumentation which measures the time which is spent in the
+ * individual processing stages of the SpektrumSatellite (from the byte
+ * availability up to the write of the send buffer).
+ *
+ * The profiler is only compiled in if SPEKTRUM_PROFILE is defined before
+ * including SpektrumSatellite.h. Otherwise the SPEKTRUM_PROFILE_XXX macros are
+ * empty and the SpektrumSatellite does not contain any profiler data.
+ *
+ * The time is measured in ticks: CPU cycles on the ESP32 and ESP8266,
+ * nanoseconds on a host (steady_clock) and micros() on all other boards. On a
+ * host the ticks have 64 bits (32 bits of nanoseconds would wrap after 4.3
+ * seconds): we only record the durations which are stored with 32 bits.
+ * @author Phil Schatzmann
+ */
+
+#pragma once
+
+#include "Arduino.h"
+#if !defined(ARDUINO)
+#include <chrono>
+#endif
+
+// Number of histogram buckets per stage
+#ifndef SPEKTRUM_PROFILE_BUCKETS
+#define SPEKTRUM_PROFILE_BUCKETS 8
+#endif
+// The first bucket counts the measurements < 2^SPEKTRUM_PROFILE_SHIFT ticks,
+// each following bucket covers 4 times the range of the previous one
+#ifndef SPEKTRUM_PROFILE_SHIFT
+#define SPEKTRUM_PROFILE_SHIFT 4
+#endif
+#define PROFILE_STAGE_COUNT 7
+
+// Point in time in ticks
+#if !defined(ARDUINO)
+typedef uint64_t ProfileTicks;
+#else
+typedef uint32_t ProfileTicks;
+#endif
+
+// Measured processing stages
+enum ProfileStage {
+  StageAvailable,
+  StageSkip,
+  StageReadBytes,
+  StageParseFrame,
+  StageScale,
+  StageSendBuffer,
+  StageWrite
+};
+
+// Statistics of a single stage
+struct ProfileStatistics {
+  uint32_t min;
+  uint32_t max;
+  uint32_t count;
+  uint64_t sum;
+  uint32_t histogram[SPEKTRUM_PROFILE_BUCKETS];
+};
+
+/**
+ * @brief Collects min, max, mean and a histogram per ProfileStage. Recording
+ * a measurement does not allocate memory and does not do any formatting.
+ * @author Phil Schatzmann
+ */
+class SpektrumProfiler {
+ public:
+  SpektrumProfiler() { reset(); }
+
+  // Provides the current time in ticks
+  static ProfileTicks ticks() {
+#if defined(ESP32) || defined(ESP8266)
+    return ESP.getCycleCount();
+#elif !defined(ARDUINO)
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#else
+    return micros();
+#endif
+  }
+
+  // Ticks since start: longer durations are recorded as UINT32_MAX
+  static uint32_t elapsed(ProfileTicks start) {
+    ProfileTicks result = ticks() - start;
+    return result > UINT32_MAX ? UINT32_MAX : (uint32_t)result;
+  }
+
+  // Adds a measurement to the statistics of the indicated stage
+  void record(ProfileStage stage, uint32_t ticks) {
+    add(statistics[stage], ticks);
+  }
+
+  // Adds a measurement to the indicated statistics
+  static void add(ProfileStatistics& stat, uint32_t ticks) {
+    if (ticks < stat.min) stat.min = ticks;
+    if (ticks > stat.max) stat.max = ticks;
+    stat.count++;
+    stat.sum += ticks;
+    stat.histogram[bucket(ticks)]++;
+  }
+
+  static void reset(ProfileStatistics& stat) {
+    memset(&stat, 0, sizeof(stat));
+    stat.min = UINT32_MAX;
+  }
+
+  // Prints the count, min, max, mean and histogram
+  static void printTo(Print& out, const char* name, ProfileStatistics& stat) {
+    out.print(name);
+    out.print(": count=");
+    out.print(stat.count);
+    out.print(" min=");
+    out.print(stat.min);
+    out.print(" max=");
+    out.print(stat.max);
+    out.print(" mean=");
+    out.print(stat.count == 0 ? 0 : (uint32_t)(stat.sum / stat.count));
+    out.print(" histogram=");
+    for (int b = 0; b < SPEKTRUM_PROFILE_BUCKETS; b++) {
+      if (b > 0) out.print("/");
+      out.print(stat.histogram[b]);
+    }
+    out.println();
+  }
+
+  ProfileStatistics& getStatistics(ProfileStage stage) {
+    return statistics[stage];
+  }
+
+  // Average number of ticks of the indicated stage
+  uint32_t getMean(ProfileStage stage) {
+    ProfileStatistics& stat = statistics[stage];
+    return stat.count == 0 ? 0 : stat.sum / stat.count;
+  }
+
+  // Upper limit (exclusive) of the ticks which are counted in the bucket
+  static uint32_t getBucketLimit(int bucket) {
+    return 1UL << (SPEKTRUM_PROFILE_SHIFT + 2 * bucket);
+  }
+
+  const char* getStageName(ProfileStage stage) {
+    static const char* names[] = {"available", "skip",       "readBytes",
+                                  "parseFrame", "scale",     "sendBuffer",
+                                  "write"};
+    return names[stage];
+  }
+
+  void reset() {
+    for (int j = 0; j < PROFILE_STAGE_COUNT; j++) reset(statistics[j]);
+  }
+
+  // Prints the statistics of all stages which have been measured
+  void printTo(Print& out) {
+    for (int j = 0; j < PROFILE_STAGE_COUNT; j++) {
+      if (statistics[j].count == 0) continue;
+      printTo(out, getStageName((ProfileStage)j), statistics[j]);
+    }
+  }
+
+ private:
+  ProfileStatistics statistics[PROFILE_STAGE_COUNT];
+
+  static int bucket(uint32_t ticks) {
+    int result = 0;
+    ticks >>= SPEKTRUM_PROFILE_SHIFT;
+    while (ticks > 0 && result < SPEKTRUM_PROFILE_BUCKETS - 1) {
+      ticks >>= 2;
+      result++;
+    }
+    return result;
+  }
+};
+
+#ifdef SPEKTRUM_PROFILE
+#define SPEKTRUM_PROFILE_START(name) \
+  ProfileTicks name = SpektrumProfiler::ticks()
+#define SPEKTRUM_PROFILE_END(stage, name) \
+  profiler.record(stage, SpektrumProfiler::elapsed(name))
+#else
+#define SPEKTRUM_PROFILE_START(name)
+#define SPEKTRUM_PROFILE_END(stage, name)
+#endif
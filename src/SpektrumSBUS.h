@@ -0,0 +1,120 @@
+/**
+ * Encodes the raw channel values of the SpektrumSatellite into a SBUS frame,
+ * so that we can forward the data to flight controllers which expect SBUS.
+ *
+ * A SBUS frame consists of 25 bytes: the header 0x0F, 16 channels with 11 bits
+ * each (packed LSB first into 22 bytes), a flag byte and the footer 0x00. It
+ * is sent with 100000 bps, 8 data bits, even parity and 2 stop bits on an
+ * inverted serial line (see SpektrumSBUS::getFraming()).
+ *
+ * The conversion uses integer arithmetic only: the 1024 or 2048 Spektrum
+ * range is mapped linearly to the defined SBUS range.
+ * @author Phil Schatzmann
+ */
+
+#pragma once
+
+#include "SpektrumSatellite.h"
+
+#define SBUS_FRAME_SIZE 25
+#define SBUS_CHANNELS 16
+#define SBUS_HEADER 0x0F
+#define SBUS_FOOTER 0x00
+#define SBUS_BPS 100000
+#define SBUS_MIN 172
+#define SBUS_MAX 1811
+#define SBUS_CENTER 992
+#define SBUS_FLAG_CH17 0x01
+#define SBUS_FLAG_CH18 0x02
+#define SBUS_FLAG_FRAME_LOST 0x04
+#define SBUS_FLAG_FAILSAFE 0x08
+
+// Serial settings of the SBUS line
+struct SBUSFraming {
+  long bps;
+  uint8_t dataBits;
+  char parity;
+  uint8_t stopBits;
+  bool inverted;
+};
+
+// Position of the channel bits in the frame: byte index and bit shift
+static const uint8_t SBUSPacking[SBUS_CHANNELS][2] = {
+    {1, 0},  {2, 3},  {3, 6},  {5, 1},  {6, 4},  {7, 7},  {9, 2},  {10, 5},
+    {12, 0}, {13, 3}, {14, 6}, {16, 1}, {17, 4}, {18, 7}, {20, 2}, {21, 5}};
+
+/**
+ * @brief SBUS Encoder
+ * @author Phil Schatzmann
+ */
+class SpektrumSBUS {
+ public:
+  // Defines the SBUS values for the minimum and maximum Spektrum value: use
+  // (0, 2048) to pass the 2048 values unchanged
+  SpektrumSBUS(uint16_t min = SBUS_MIN, uint16_t max = SBUS_MAX) {
+    setRange(min, max);
+    for (int ch = 0; ch < SBUS_CHANNELS; ch++) unusedValues[ch] = SBUS_CENTER;
+  }
+
+  void setRange(uint16_t min, uint16_t max) {
+    this->min = min;
+    this->range = max - min;
+  }
+
+  // Value which is sent for the channels 13-16 (index 12-15) which Spektrum
+  // does not provide: returns false for any other channel
+  bool setUnusedValue(int channel, uint16_t value) {
+    if (channel < MAX_CHANNELS || channel >= SBUS_CHANNELS) return false;
+    unusedValues[channel] = value;
+    return true;
+  }
+
+  static SBUSFraming getFraming() {
+    SBUSFraming result = {SBUS_BPS, 8, 'E', 2, true};
+    return result;
+  }
+
+  // Encodes the raw values of the satellite and reports the failsafe state
+  template <class T, int Options>
+  uint8_t* encode(SpektrumSatellite<T, Options>& satellite) {
+    uint8_t flags = satellite.isFailsafe()
+                        ? SBUS_FLAG_FAILSAFE | SBUS_FLAG_FRAME_LOST
+                        : 0;
+    return encode(satellite.getChannelValuesRaw(), satellite.is2048(), flags);
+  }
+
+  // Encodes MAX_CHANNELS raw Spektrum values (0-1023 or 0-2047)
+  uint8_t* encode(const uint16_t* channelValues, bool is2048,
+                  uint8_t flags = 0) {
+    memset(frame, 0, sizeof(frame));
+    frame[0] = SBUS_HEADER;
+    uint8_t shift = is2048 ? 11 : 10;
+    for (int ch = 0; ch < SBUS_CHANNELS; ch++) {
+      uint16_t value =
+          ch < MAX_CHANNELS
+              ? min + (uint16_t)(((uint32_t)channelValues[ch] * range) >> shift)
+              : unusedValues[ch];
+      pack(ch, value);
+    }
+    frame[SBUS_FRAME_SIZE - 2] = flags;
+    frame[SBUS_FRAME_SIZE - 1] = SBUS_FOOTER;
+    return frame;
+  }
+
+  // Provides the last encoded frame
+  uint8_t* getFrame() { return frame; }
+
+ private:
+  uint8_t frame[SBUS_FRAME_SIZE];
+  uint16_t unusedValues[SBUS_CHANNELS];
+  uint16_t min;
+  uint16_t range;
+
+  void pack(int channel, uint16_t value) {
+    uint8_t index = SBUSPacking[channel][0];
+    uint32_t bits = (uint32_t)(value & 0x07FF) << SBUSPacking[channel][1];
+    frame[index] |= bits;
+    frame[index + 1] |= bits >> 8;
+    if (SBUSPacking[channel][1] > 5) frame[index + 2] |= bits >> 16;
+  }
+};
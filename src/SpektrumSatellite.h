@@ -11,6 +11,10 @@
  * - Support for sending data
  * - Checks the endianness (in Arudino the processor is little endian, the
  * protocal sends all data fields as big-endian)
+ * - Optional profiling of the processing stages (define SPEKTRUM_PROFILE)
+ * - Unused features can be removed with SpektrumOptions to save RAM
+ * - Optional reordering and reversing of the channels, failsafe, callbacks and
+ * snapshots from other threads (requested with SpektrumOptions)
  * @author Phil Schatzmann
  */
 
@@ -18,6 +22,7 @@
 
 #include "Arduino.h"
 #include "Scaler.h"
+#include "SpektrumProfiler.h"
 
 #define TRANSACTION_TIME 1000
 #define DEFAULT_RECEIVING_TIMEOUT 10000
@@ -27,8 +32,33 @@
 #define MASK_2048_CHANID 0x7800
 #define MASK_2048_SXPOS 0x07FF
 #define SEND_BUFFER_SIZE sizeof(Data)
-#define BINDING_PULSE_DELAY_MS 100
+#define BINDING_PULSE_US 100
+// old name: the value has always been used in us
+#define BINDING_PULSE_DELAY_MS BINDING_PULSE_US
+#define BINDING_POWER_OFF_MS 2000
+#define BINDING_POWER_ON_MS 50
+// the pulses must be sent within 200ms after the power on
+#define BINDING_WINDOW_MS 200
+#define BINDING_MAX_RETRIES 3
+#define BINDING_SETTLE_MS 500
 #define SPEKTRUM_SATELLITE_BPS 125000
+#define WAIT_FOR_DATA_POLL_MS 10
+#define FAILSAFE_MISSED_FRAMES 3
+#define FRAME_PERIOD_MAX_MS 100
+
+// Memory barriers for the snapshot sequence (see readSnapshot()): on the single
+// core AVR processors we only need to prevent the reordering by the compiler.
+// The writer only needs to order its stores and the reader its loads: on x86
+// the release and acquire barriers do not emit any instruction.
+#if defined(__AVR__)
+#define SPEKTRUM_BARRIER() __asm__ __volatile__("" ::: "memory")
+#define SPEKTRUM_RELEASE_BARRIER() SPEKTRUM_BARRIER()
+#define SPEKTRUM_ACQUIRE_BARRIER() SPEKTRUM_BARRIER()
+#else
+#define SPEKTRUM_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define SPEKTRUM_RELEASE_BARRIER() __atomic_thread_fence(__ATOMIC_RELEASE)
+#define SPEKTRUM_ACQUIRE_BARRIER() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#endif
 
 // Defines the number of falling pulses when Binding
 enum BindMode {
@@ -45,6 +75,17 @@ enum BindMode {
 // Is it working ?
 enum Status { NotConnected, Binding, Receiving };
 
+// Steps of the (non blocking) binding process
+enum BindingState {
+  BindingIdle,
+  BindingPowerOff,
+  BindingPowerOn,
+  BindingPulses,
+  BindingSettle,
+  BindingDone,
+  BindingFailed
+};
+
 // Define all 12 Available Channels
 enum Channel {
   Throttle,
@@ -83,26 +124,574 @@ struct __attribute__((__packed__)) Data {
   uint16_t values[7];
 };
 
+// Consistent copy of the received data (see readSnapshot())
+struct SpektrumSnapshot {
+  uint16_t channelValues[MAX_CHANNELS];
+  uint16_t fades;
+  System system;
+  // millis() of the last update
+  unsigned long timestamp;
+};
+
+// Options to remove unused features from the SpektrumSatellite or to add the
+// optional ones: combine them with | (e.g. SpektrumReceiveOnly | SpektrumNoLog)
+enum SpektrumOptions {
+  // the features of the original SpektrumSatellite
+  SpektrumDefault = 0,
+  // no send buffer
+  SpektrumReceiveOnly = 1,
+  // no receiving and binding state
+  SpektrumSendOnly = 2,
+  // the channel values are provided unscaled
+  SpektrumNoScaler = 4,
+  // no frame and send counters
+  SpektrumNoStats = 8,
+  // no logging
+  SpektrumNoLog = 16,
+  // setChannelMap() and setChannelReversed()
+  SpektrumWithChannelMap = 32,
+  // failsafe values and the detection of a lost link (see setFailsafeValue())
+  SpektrumWithFailsafe = 64,
+  // onFrame(), onConnectionLost() and onSystemDetected()
+  SpektrumWithCallbacks = 128,
+  // readSnapshot() from another thread or core while getFrame() is running
+  SpektrumWithSnapshot = 256,
+  // all optional features
+  SpektrumAll = SpektrumWithChannelMap | SpektrumWithFailsafe |
+                SpektrumWithCallbacks | SpektrumWithSnapshot
+};
+
+// Common channel orders for setChannelMap(): the remaining channels follow in
+// the Spektrum order (which is TAER)
+const static Channel ChannelOrderAETR[] = {Aileron, Elevator, Throttle, Rudder};
+const static Channel ChannelOrderTAER[] = {Throttle, Aileron, Elevator, Rudder};
+const static Channel ChannelOrderAERT[] = {Aileron, Elevator, Rudder, Throttle};
+
+/**
+ * @brief Optional logging of the SpektrumSatellite. The specialization for
+ * false does not contain any data and all methods are empty, so that the
+ * logging strings are removed by the compiler.
+ * @author Phil Schatzmann
+ */
+template <bool Active>
+class SpektrumLog {
+ public:
+  void setLog(Stream& logSer) { this->serialLog = &logSer; }
+
+  void setLogMod(long value) { this->logMod = value; }
+
+  long getLogMod() { return logMod; }
+
+  Stream* getLog() { return serialLog; }
+
+  void log(const char* str) {
+    if (serialLog == NULL) return;
+    serialLog->println(str);
+  }
+
+  void log(const char* str, const char* str1) {
+    if (serialLog == NULL) return;
+    serialLog->print(str);
+    serialLog->print(" ");
+    serialLog->println(str1);
+  }
+
+  void log1(const char* str) {
+    if (serialLog == NULL) return;
+    serialLog->print(" ");
+  }
+
+  void log(const char* str, int value) {
+    if (serialLog == NULL) return;
+    serialLog->print(str);
+    serialLog->print(" ");
+    serialLog->println(value);
+  }
+
+  void logHex(const char* str, int value) {
+    if (serialLog == NULL) return;
+    serialLog->print(str);
+    serialLog->print(" ");
+    serialLog->println(value, HEX);
+  }
+
+ private:
+  Stream* serialLog = NULL;
+  long logMod = 1000;
+};
+
+template <>
+class SpektrumLog<false> {
+ public:
+  void setLog(Stream& logSer) {}
+  void setLogMod(long value) {}
+  long getLogMod() { return 0; }
+  Stream* getLog() { return NULL; }
+  void log(const char* str) {}
+  void log(const char* str, const char* str1) {}
+  void log1(const char* str) {}
+  void log(const char* str, int value) {}
+  void logHex(const char* str, int value) {}
+};
+
 /**
- * @brief Spktrum Sattellite Protocol API
+ * @brief Optional frame and send counters of the SpektrumSatellite
  * @author Phil Schatzmann
  */
+template <bool Active>
+class SpektrumStats {
+ public:
+  unsigned long getFrameCount() { return frameCount; }
+  unsigned long getSuccessCount() { return successCount; }
+  unsigned long getFailCount() { return failCount; }
+  unsigned long getSendCount() { return sendCount; }
+
+ protected:
+  void countFrame(bool success) {
+    if (success) {
+      successCount++;
+    } else {
+      failCount++;
+    }
+    frameCount++;
+  }
+
+  void countSend() { sendCount++; }
+
+ private:
+  unsigned long successCount = 0;
+  unsigned long failCount = 0;
+  unsigned long frameCount = 0;
+  unsigned long sendCount = 0;
+};
+
+template <>
+class SpektrumStats<false> {
+ public:
+  unsigned long getFrameCount() { return 0; }
+  unsigned long getSuccessCount() { return 0; }
+  unsigned long getFailCount() { return 0; }
+  unsigned long getSendCount() { return 0; }
+
+ protected:
+  void countFrame(bool success) {}
+  void countSend() {}
+};
+
+/**
+ * @brief Optional scaling of the channel values of the SpektrumSatellite
+ * @author Phil Schatzmann
+ */
+template <class T, bool Active>
+class SpektrumScaling {
+ public:
+  // Provides access to the Scaler
+  Scaler<T>* getScaler() { return &scaler; }
+
+ protected:
+  T scaleValue(uint16_t value) { return scaler.scale(value); }
+
+  uint16_t deScaleValue(T value) { return scaler.deScale(value); }
+
+  void setScalerRange(T inMax, T min, T max) {
+    scaler.setActive(true);
+    scaler.setValues(0, inMax, min, max);
+  }
+
+ private:
+  Scaler<T> scaler;
+};
+
 template <class T>
-class SpektrumSatellite {
+class SpektrumScaling<T, false> {
+ public:
+  Scaler<T>* getScaler() { return NULL; }
+
+ protected:
+  T scaleValue(uint16_t value) { return value; }
+  uint16_t deScaleValue(T value) { return value; }
+  void setScalerRange(T inMax, T min, T max) {}
+};
+
+/**
+ * @brief Optional reordering and reversing of the channels of the
+ * SpektrumSatellite: the mapping is done while the words of a frame are
+ * decoded or encoded, so that no additional copy is needed.
+ * @author Phil Schatzmann
+ */
+template <bool Active>
+class SpektrumChannelMap {
+ public:
+  SpektrumChannelMap() {
+    for (int j = 0; j < MAX_CHANNELS; j++) positions[j] = j;
+  }
+
+  // Defines the order of the channels: order[i] is the Spektrum channel which
+  // is provided at position i (e.g. ChannelOrderAETR). The channels which are
+  // not listed follow in the Spektrum order. Returns false if a channel is
+  // invalid or listed twice.
+  bool setChannelMap(const Channel* order, int len) {
+    uint8_t newPositions[MAX_CHANNELS];
+    uint16_t used = 0;
+    if (len > MAX_CHANNELS) return false;
+    for (int j = 0; j < len; j++) {
+      if (order[j] < Throttle || order[j] > Aux7 || (used & (1 << order[j]))) {
+        return false;
+      }
+      used |= 1 << order[j];
+      newPositions[order[j]] = j;
+    }
+    int next = len;
+    for (int ch = 0; ch < MAX_CHANNELS; ch++) {
+      if (!(used & (1 << ch))) newPositions[ch] = next++;
+    }
+    memcpy(positions, newPositions, sizeof(positions));
+    return true;
+  }
+
+  template <int N>
+  bool setChannelMap(const Channel (&order)[N]) {
+    return setChannelMap(order, N);
+  }
+
+  // Inverts the values of the indicated Spektrum channel
+  void setChannelReversed(Channel channelId, bool reversed) {
+    if (reversed) {
+      reversedMask |= 1 << channelId;
+    } else {
+      reversedMask &= ~(1 << channelId);
+    }
+  }
+
+  bool isChannelReversed(Channel channelId) {
+    return reversedMask & (1 << channelId);
+  }
+
+  // Position at which the Spektrum channel is provided
+  uint8_t getChannelPosition(Channel channelId) { return positions[channelId]; }
+
+ protected:
+  uint8_t positions[MAX_CHANNELS];
+  uint16_t reversedMask = 0;
+
+  uint8_t mapChannel(uint16_t channelId) { return positions[channelId]; }
+
+  // inverts the value within the mask if the channel is reversed
+  uint16_t mapValue(uint16_t channelId, uint16_t value, uint16_t mask) {
+    return value ^ (mask & -(uint16_t)((reversedMask >> channelId) & 1));
+  }
+};
+
+template <>
+class SpektrumChannelMap<false> {
+ public:
+  bool setChannelMap(const Channel* order, int len) { return false; }
+  template <int N>
+  bool setChannelMap(const Channel (&order)[N]) {
+    return false;
+  }
+  void setChannelReversed(Channel channelId, bool reversed) {}
+  bool isChannelReversed(Channel channelId) { return false; }
+  uint8_t getChannelPosition(Channel channelId) { return channelId; }
+
+ protected:
+  uint8_t mapChannel(uint16_t channelId) { return channelId; }
+  uint16_t mapValue(uint16_t channelId, uint16_t value, uint16_t mask) {
+    return value;
+  }
+};
+
+/**
+ * @brief Data which is only needed to send frames
+ * @author Phil Schatzmann
+ */
+template <bool Active>
+class SpektrumSendState {
+ protected:
+  Data dataPacket;
+  boolean isSendAuxData = false;
+
+  void setSendAuxData(bool flag) { isSendAuxData = flag; }
+};
+
+template <>
+class SpektrumSendState<false> {
+ protected:
+  void setSendAuxData(bool flag) {}
+};
+
+/**
+ * @brief Data which is only needed to receive frames: timing and binding
+ * @author Phil Schatzmann
+ */
+template <bool Active>
+class SpektrumReceiveState {
+ public:
+  // Time source in us and pin output which are used by the binding
+  typedef unsigned long (*BindingClock)();
+  typedef void (*BindingPinWrite)(unsigned pin, bool high, void* ref);
+
+  // Checks if the system has already been taken over from a frame (internal
+  // mode)
+  bool isSystemReceived() { return isSystemReported; }
+
+ protected:
+  unsigned long timeOfLastRead = 0;
+  boolean processAllData = false;
+  boolean isSystemReported = false;
+  BindingState bindingState = BindingIdle;
+  unsigned bindingPowerPin;
+  unsigned bindingRxPin;
+  unsigned long bindingStartUs;
+  unsigned long bindingStepStartUs;
+  uint8_t bindingRetries;
+  BindingClock bindingClock = NULL;
+  BindingPinWrite bindingPinWrite = NULL;
+  void* bindingPinWriteRef = NULL;
+};
+
+template <>
+class SpektrumReceiveState<false> {
+ public:
+  typedef unsigned long (*BindingClock)();
+  typedef void (*BindingPinWrite)(unsigned pin, bool high, void* ref);
+
+  bool isSystemReceived() { return false; }
+};
+
+/**
+ * @brief Optional failsafe values and measurement of the frame period of the
+ * SpektrumSatellite (SpektrumWithFailsafe)
+ * @author Phil Schatzmann
+ */
+template <bool Active>
+class SpektrumFailsafe {
+ public:
+  // Checks if the failsafe values are active
+  bool isFailsafe() { return isFailsafeActive; }
+
+ protected:
+  boolean isFailsafeActive = false;
+  uint8_t failsafeFrames = FAILSAFE_MISSED_FRAMES;
+  uint16_t failsafePresetMask = 0;
+  uint16_t failsafeValues[MAX_CHANNELS];
+  unsigned measuredFramePeriod = 0;
+
+  uint8_t getFailsafeFrames() { return failsafeFrames; }
+
+  unsigned getMeasuredFramePeriod() { return measuredFramePeriod; }
+
+  // smoothes the period between the last two frames
+  void measureFramePeriod(unsigned long period) {
+    if (period > 0 && period < FRAME_PERIOD_MAX_MS) {
+      unsigned last = measuredFramePeriod;
+      measuredFramePeriod = last == 0 ? period : (3 * last + period) / 4;
+    }
+  }
+
+  void setFailsafeActive(bool active) { isFailsafeActive = active; }
+
+  // replaces the channel values which have a failsafe value
+  void applyFailsafe(uint16_t* channelValues) {
+    isFailsafeActive = true;
+    for (int j = 0; j < MAX_CHANNELS; j++) {
+      if (failsafePresetMask & (1 << j)) channelValues[j] = failsafeValues[j];
+    }
+  }
+};
+
+template <>
+class SpektrumFailsafe<false> {
+ public:
+  bool isFailsafe() { return false; }
+
+ protected:
+  uint8_t getFailsafeFrames() { return FAILSAFE_MISSED_FRAMES; }
+  unsigned getMeasuredFramePeriod() { return 0; }
+  void measureFramePeriod(unsigned long period) {}
+  void setFailsafeActive(bool active) {}
+  void applyFailsafe(uint16_t* channelValues) {}
+};
+
+/**
+ * @brief Optional callbacks of the SpektrumSatellite (SpektrumWithCallbacks)
+ * @author Phil Schatzmann
+ */
+template <class S, bool Active>
+class SpektrumCallbacks {
+ public:
+  // Callbacks: ref is the pointer which was provided at the registration
+  typedef void (*FrameCallback)(S& satellite, void* ref);
+  typedef void (*SystemCallback)(System system, void* ref);
+
+ protected:
+  FrameCallback frameCallback = NULL;
+  void* frameCallbackRef = NULL;
+  FrameCallback connectionLostCallback = NULL;
+  void* connectionLostCallbackRef = NULL;
+  SystemCallback systemCallback = NULL;
+  void* systemCallbackRef = NULL;
+
+  void notifyFrame(S& satellite) {
+    if (frameCallback != NULL) frameCallback(satellite, frameCallbackRef);
+  }
+
+  void notifyConnectionLost(S& satellite) {
+    if (connectionLostCallback != NULL) {
+      connectionLostCallback(satellite, connectionLostCallbackRef);
+    }
+  }
+
+  void notifySystem(System system) {
+    if (systemCallback != NULL) systemCallback(system, systemCallbackRef);
+  }
+};
+
+template <class S>
+class SpektrumCallbacks<S, false> {
+ public:
+  typedef void (*FrameCallback)(S& satellite, void* ref);
+  typedef void (*SystemCallback)(System system, void* ref);
+
+ protected:
+  void notifyFrame(S& satellite) {}
+  void notifyConnectionLost(S& satellite) {}
+  void notifySystem(System system) {}
+};
+
+/**
+ * @brief Optional sequence counter which makes readSnapshot() consistent while
+ * another thread or core updates the channels (SpektrumWithSnapshot)
+ * @author Phil Schatzmann
+ */
+template <bool Active>
+class SpektrumSnapshotState {
+ public:
+  // All changes between beginUpdate() and endUpdate() are seen as one update
+  // by readSnapshot() (e.g. when several channels are set). The calls can be
+  // nested: only the outermost call updates the sequence and the time. Do not
+  // call readSnapshot() in between from the same thread.
+  void beginUpdate() {
+    if (updateDepth > 0) {
+      updateDepth++;
+      return;
+    }
+    beginUpdate(millis());
+  }
+
+  // Starts an update with the time (in ms) which is already known
+  void beginUpdate(unsigned long now) {
+    if (updateDepth++ > 0) return;
+    // the writer never waits: it only makes the sequence odd while updating
+    sequence = sequence + 1;
+    SPEKTRUM_RELEASE_BARRIER();
+    timeOfUpdate = now;
+  }
+
+  void endUpdate() {
+    if (--updateDepth > 0) return;
+    SPEKTRUM_RELEASE_BARRIER();
+    sequence = sequence + 1;
+  }
+
+ protected:
+  // odd while the received data is updated
+  volatile unsigned sequence = 0;
+  volatile unsigned long timeOfUpdate = 0;
+  uint8_t updateDepth = 0;
+
+  unsigned getSequence() { return sequence; }
+
+  unsigned long getUpdateTime() { return timeOfUpdate; }
+};
+
+template <>
+class SpektrumSnapshotState<false> {
  public:
+  void beginUpdate() {}
+  void beginUpdate(unsigned long now) {}
+  void endUpdate() {}
+
+ protected:
+  unsigned getSequence() { return 0; }
+  unsigned long getUpdateTime() { return 0; }
+};
+
+/**
+ * @brief Spktrum Sattellite Protocol API. The optional Options (see
+ * SpektrumOptions) remove the data and code of unused features.
+ * @author Phil Schatzmann
+ */
+template <class T, int Options = SpektrumDefault>
+class SpektrumSatellite
+    : public SpektrumLog<!(Options & SpektrumNoLog)>,
+      public SpektrumStats<!(Options & SpektrumNoStats)>,
+      public SpektrumScaling<T, !(Options & SpektrumNoScaler)>,
+      public SpektrumChannelMap<(Options & SpektrumWithChannelMap) != 0>,
+      public SpektrumSendState<!(Options & SpektrumReceiveOnly)>,
+      public SpektrumReceiveState<!(Options & SpektrumSendOnly)>,
+      public SpektrumFailsafe<(Options & SpektrumWithFailsafe) != 0>,
+      public SpektrumCallbacks<SpektrumSatellite<T, Options>,
+                               (Options & SpektrumWithCallbacks) != 0>,
+      public SpektrumSnapshotState<(Options & SpektrumWithSnapshot) != 0> {
+  typedef SpektrumLog<!(Options & SpektrumNoLog)> Log;
+  typedef SpektrumStats<!(Options & SpektrumNoStats)> Stats;
+  typedef SpektrumScaling<T, !(Options & SpektrumNoScaler)> Scaling;
+  typedef SpektrumChannelMap<(Options & SpektrumWithChannelMap) != 0>
+      ChannelMap;
+  typedef SpektrumSendState<!(Options & SpektrumReceiveOnly)> SendState;
+  typedef SpektrumReceiveState<!(Options & SpektrumSendOnly)> ReceiveState;
+  typedef SpektrumCallbacks<SpektrumSatellite<T, Options>,
+                            (Options & SpektrumWithCallbacks) != 0>
+      Callbacks;
+
+ public:
+  typedef typename Callbacks::FrameCallback FrameCallback;
+  typedef typename Callbacks::SystemCallback SystemCallback;
+  typedef typename ReceiveState::BindingClock BindingClock;
+  typedef typename ReceiveState::BindingPinWrite BindingPinWrite;
+  using Log::getLogMod;
+  using Log::log;
+  using Log::log1;
+  using Log::logHex;
+  using Log::setLog;
+  using Log::setLogMod;
+  using Scaling::getScaler;
+
   // Constructor
   SpektrumSatellite(Stream& serial);
 
   // Defines the binding mode
   void setBindingMode(BindMode bindMode);
 
-  // Set the receiver in binding mode
+  // Set the receiver in binding mode (blocking for about 2.5 seconds or
+  // longer if the binding needs to be retried)
   void startBinding(unsigned powerPin, unsigned rxPin);
 
+  // Starts the binding: call pollBinding() until it returns true
+  void beginBinding(unsigned powerPin, unsigned rxPin);
+
+  // Executes the next binding step if it is due: returns true when done or
+  // when it failed (BindingFailed)
+  bool pollBinding();
+
+  // Replaces micros() and digitalWrite() of the binding (e.g. for tests): NULL
+  // uses the Arduino functions
+  void setBindingIO(BindingClock clock, BindingPinWrite pinWrite,
+                    void* ref = NULL);
+
+  // Determines the current binding step
+  BindingState getBindingState();
+
+  // Binding progress in percent
+  int getBindingProgress();
+
   // Receive a data record from the Satellite Receiver
   bool getFrame(int timeout = DEFAULT_RECEIVING_TIMEOUT);
 
-  // Gets the scaled value for the indicated channel
+  // Gets the scaled value for the indicated channel. With a channel map
+  // (SpektrumWithChannelMap) the channel is the position: e.g. getThrottle()
+  // returns position 0, which contains Aileron for ChannelOrderAETR
   T getChannelValue(Channel channelId);
   T getThrottle();
   T getAileron();
@@ -117,7 +706,12 @@ class SpektrumSatellite {
   T getAux6();
   T getAux7();
 
+  // Each call is one update of the snapshot (SpektrumWithSnapshot): wrap
+  // several calls with beginUpdate() and endUpdate() to update it only once.
+  // Like the getters the setters use the position of a channel map
   void setChannelValue(Channel channelId, T value);
+  // sets the unconverted channel value (0-1023 or 0-2047)
+  void setChannelValueRaw(Channel channelId, uint16_t value);
   void setThrottle(T value);
   void setAileron(T value);
   void setElevator(T value);
@@ -134,22 +728,57 @@ class SpektrumSatellite {
   void sendData();
   void sendData(uint8_t* str);
 
-  // Checks that we did not time out
+  // Checks that we did not time out (TRANSACTION_TIME)
   bool isConnected();
+  // Checks that we received a frame within the indicated time
   bool isConnected(long timeoutMs);
+  // Checks that no frame has been received within the failsafe timeout (see
+  // setFailsafeFrames()): the test which triggers the failsafe in getFrame()
+  bool isLinkStale();
 
   // wait for any data
   void waitForData();
 
-  // Provides the channel name as string
+  // Expected time between frames in ms (from the system or measured)
+  unsigned getFramePeriod();
+
+  // Number of missed frames after which the failsafe values are applied (at
+  // least 1): needs SpektrumWithFailsafe
+  void setFailsafeFrames(uint8_t frames);
+
+  // Defines the value which is applied when the link is lost: needs
+  // SpektrumWithFailsafe
+  void setFailsafeValue(Channel channelId, T value);
+
+  // Keep the last received value when the link is lost (default)
+  void setFailsafeHold(Channel channelId);
+
+  // The callbacks need SpektrumWithCallbacks. The connection lost callback is
+  // called by getFrame() after the failsafe frames (see setFailsafeFrames())
+  // without data.
+
+  // Called by getFrame() after a valid frame has been decoded
+  void onFrame(FrameCallback callback, void* ref = NULL);
+  template <class F>
+  void onFrame(F& callable);
+
+  // Called by getFrame() when the connection is lost
+  void onConnectionLost(FrameCallback callback, void* ref = NULL);
+  template <class F>
+  void onConnectionLost(F& callable);
+
+  // Called by parseFrame() with the system reported by the Satellite
+  void onSystemDetected(SystemCallback callback, void* ref = NULL);
+  template <class F>
+  void onSystemDetected(F& callable);
+
+  // Provides the channel name as string: the name of the Spektrum channel
+  // and not of the channel which a channel map puts at this position
   const char* getChannelName(Channel channelId);
 
   // Defines the maximum value that we expect or provide to the API
   void setChannelValueRange(T min, T max);
 
-  // Provides access to the Scaler
-  Scaler<T>* getScaler();
-
   // Sets the system which defines the data format (e.g. 1024 or 2048 servo
   // data)
   void setSystem(System system);
@@ -166,6 +795,9 @@ class SpektrumSatellite {
   // switch endianness if necessary for processors which are little endian
   void switchEndianness();
 
+  // checks if the channel words are interpreted as big endian
+  bool isBigEndianData();
+
   // checks if the biggest number is 2048 (instead of 1024)
   bool is2048();
 
@@ -182,44 +814,54 @@ class SpektrumSatellite {
   bool parseFrame(Data* inData);
   Data* getSendBuffer(boolean auxData);
   Data* getSendBuffer();
-  // logging
-  void setLog(Stream& log);
-  void setLogMod(long value);
-  void log(const char*);
-  void log1(const char*);
-  void log(const char*, const char*);
-  void log(const char*, int value);
-  void logHex(const char*, int value);
   // provides the unconverted channel values
   uint16_t* getChannelValuesRaw();
 
+  // Copies the channel values, fades, system and timestamp: with
+  // SpektrumWithSnapshot it can be called from another thread or core while
+  // getFrame() is running. Do not call it from an interrupt which might
+  // interrupt getFrame().
+  void readSnapshot(SpektrumSnapshot& snapshot);
+
+#ifdef SPEKTRUM_PROFILE
+  // Provides the measured processing times
+  SpektrumProfiler* getProfiler();
+#endif
+
  private:
-  uint16_t channelValues[12];
-  Data dataPacket;  //;uint16_t sendValues[7];
-  unsigned long timeOfLastRead;
-  unsigned long successCount;
-  unsigned long failCount;
-  unsigned long frameCount;
-  unsigned long sendCount;
+  uint16_t channelValues[MAX_CHANNELS] = {0};
   uint16_t maskCHANID;
   uint16_t maskVALUE;
-  uint16_t fades;
+  uint16_t fades = 0;
   System system;
   boolean isInternalFlag;
-  boolean isSendAuxData;
-  boolean isSwapBytes;
-  boolean processAllData = false;
+  boolean isSwapBytes = false;
 
   Stream* serial;
-  Stream* serialLog = NULL;
-  Scaler<T> scaler;
   BindMode bindMode;
   Status status;
-  long logMod = 1000;
+#ifdef SPEKTRUM_PROFILE
+  SpektrumProfiler profiler;
+#endif
 
   // private methods
   void logFrame(long available, bool result);
+  bool decodeFrame(Data* data, unsigned long now);
+  bool isLogDue(unsigned long count);
+  unsigned long getBindingMicros();
+  void writeBindingPin(unsigned pin, bool high);
+  void sendBindingPulses();
+  void retryBinding(unsigned long now);
   void swapBytes(uint16_t* value);
+  template <class F>
+  static void invokeFrameCallable(SpektrumSatellite<T, Options>& satellite,
+                                  void* ref) {
+    (*(F*)ref)(satellite);
+  }
+  template <class F>
+  static void invokeSystemCallable(System system, void* ref) {
+    (*(F*)ref)(system);
+  }
 };
 
 // 12 channels
@@ -229,8 +871,8 @@ const static char* ChannelNames[] = {
 
 
 
-template <class T>
-SpektrumSatellite<T>::SpektrumSatellite(Stream& serial) {
+template <class T, int Options>
+SpektrumSatellite<T, Options>::SpektrumSatellite(Stream& serial) {
   // Internal_DSMx_11ms is recommended bind value
   this->serial = &serial;
   setBindingMode(Internal_DSMx_11ms);
@@ -246,13 +888,13 @@ SpektrumSatellite<T>::SpektrumSatellite(Stream& serial) {
   }
 }
 
-template <class T>
-Status SpektrumSatellite<T>::getStatus() {
+template <class T, int Options>
+Status SpektrumSatellite<T, Options>::getStatus() {
   return this->status;
 }
 
-template <class T>
-void SpektrumSatellite<T>::setBindingMode(BindMode bindMode) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setBindingMode(BindMode bindMode) {
   log("setBindingMode");
   this->bindMode = bindMode;
 
@@ -279,13 +921,13 @@ void SpektrumSatellite<T>::setBindingMode(BindMode bindMode) {
   logHex("-> system:", system);
 }
 
-template <class T>
-System SpektrumSatellite<T>::getSystem() {
+template <class T, int Options>
+System SpektrumSatellite<T, Options>::getSystem() {
   return this->system;
 }
 
-template <class T>
-void SpektrumSatellite<T>::setSystem(System system) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setSystem(System system) {
   logHex("setSystem:", system);
   this->system = system;
 
@@ -298,13 +940,13 @@ void SpektrumSatellite<T>::setSystem(System system) {
   }
 }
 
-template <class T>
-boolean SpektrumSatellite<T>::isInternal() {
+template <class T, int Options>
+boolean SpektrumSatellite<T, Options>::isInternal() {
   return this->isInternalFlag;
 }
 
-template <class T>
-boolean SpektrumSatellite<T>::isValidSystem(int system) {
+template <class T, int Options>
+boolean SpektrumSatellite<T, Options>::isValidSystem(int system) {
   bool result = false;
   if (isInternal()) {
     // check system
@@ -323,28 +965,37 @@ boolean SpektrumSatellite<T>::isValidSystem(int system) {
   return result;
 }
 
-template <class T>
-void SpektrumSatellite<T>::setProcessAllData(bool flag) {
-  processAllData = flag;
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setProcessAllData(bool flag) {
+  this->processAllData = flag;
 }
 
-template <class T>
-bool SpektrumSatellite<T>::parseFrame(byte* inData) {
+template <class T, int Options>
+bool SpektrumSatellite<T, Options>::parseFrame(byte* inData) {
   return parseFrame((Data*)inData);
 }
 
-template <class T>
-bool SpektrumSatellite<T>::parseFrame(Data* inData) {
-  Data* data = (Data*)inData;
-  static bool systemReported = false;
+template <class T, int Options>
+bool SpektrumSatellite<T, Options>::parseFrame(Data* inData) {
+  // the time is only needed for the snapshot
+  return decodeFrame(inData, Options & SpektrumWithSnapshot ? millis() : 0);
+}
+
+template <class T, int Options>
+bool SpektrumSatellite<T, Options>::decodeFrame(Data* data,
+                                                unsigned long now) {
+  bool isSystemDetected = false;
+  System recevedSystem = (System)data->header.internal.system;
+  // the whole frame is one update of the snapshot
+  this->beginUpdate(now);
   // a frame is 16 bytes -> 7 channels + fades
   // determine system and fades
   if (isInternal()) {
     this->fades = data->header.internal.fades;
-    if (!systemReported) {
-      System recevedSystem = (System)data->header.internal.system;
+    if (!this->isSystemReported) {
       logHex("System from the Satellite:", recevedSystem);
-      systemReported = true;
+      this->isSystemReported = true;
+      isSystemDetected = true;
       if (recevedSystem != getSystem()) {
         if (isValidSystem(recevedSystem))
           setSystem(recevedSystem);
@@ -371,46 +1022,70 @@ bool SpektrumSatellite<T>::parseFrame(Data* inData) {
     // Serial.println(channelValue);
 
     if (channelID >= 0 && channelID < MAX_CHANNELS) {
-      channelValues[channelID] = channelValue;
+      channelValues[this->mapChannel(channelID)] =
+          this->mapValue(channelID, channelValue, maskVALUE);
     } else {
       // log("Invalid Channel in parseFrame: ",channelID);
     }
   }
+  this->endUpdate();
+
+  // the callback may read a snapshot: so we call it after the update
+  if (isSystemDetected) this->notifySystem(recevedSystem);
   return true;
 }
 
-template <class T>
-void SpektrumSatellite<T>::swapBytes(uint16_t* value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::swapBytes(uint16_t* value) {
   if (isSwapBytes) {
     *value = ((*value << 8) & 0xff00) | ((*value >> 8) & 0x00ff);
   }
 }
 
-template <class T>
-void SpektrumSatellite<T>::switchEndianness() {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::switchEndianness() {
   this->isSwapBytes = !this->isSwapBytes;
 }
 
-template <class T>
-bool SpektrumSatellite<T>::getFrame(int transactionTimeMs) {
+template <class T, int Options>
+bool SpektrumSatellite<T, Options>::isBigEndianData() {
+  // we swap the bytes on little endian processors
+  int n = 1;
+  bool isLittleEndian = *(char*)&n == 1;
+  return this->isSwapBytes == isLittleEndian;
+}
+
+template <class T, int Options>
+bool SpektrumSatellite<T, Options>::getFrame(int transactionTimeMs) {
   short inByte;
   byte inData[SEND_BUFFER_SIZE];
   bool result = false;
+  SPEKTRUM_PROFILE_START(availableStart);
   long available = serial->available();
+  SPEKTRUM_PROFILE_END(StageAvailable, availableStart);
 
   //  16-byte data packet every 11ms or 22ms,
   if (available >= 16) {
-    timeOfLastRead = millis();
+    unsigned long now = millis();
+    if (status == Receiving) {
+      // measure the frame period: we might have received multiple frames
+      this->measureFramePeriod((now - this->timeOfLastRead) / (available / 16));
+    }
+    this->timeOfLastRead = now;
     // resychronize and use last data
-    if (!processAllData && available > 16) {
+    if (!this->processAllData && available > 16) {
+      SPEKTRUM_PROFILE_START(skipStart);
       long diff = available - 16;
       log("skipping number of bytes:", diff);
       // skip unnecessary data
       for (int j = 0; j < diff; j++) serial->read();
+      SPEKTRUM_PROFILE_END(StageSkip, skipStart);
     }
 
     // read the latest data packet
+    SPEKTRUM_PROFILE_START(readStart);
     inByte = serial->readBytes(inData, 16);
+    SPEKTRUM_PROFILE_END(StageReadBytes, readStart);
     if (inByte != 16) {
       log("We could not read all data");
       result = false;
@@ -418,201 +1093,226 @@ bool SpektrumSatellite<T>::getFrame(int transactionTimeMs) {
       // check if we processed the data within the indicated time period
       result = isConnected(transactionTimeMs);
       if (result) {
-        parseFrame(inData);
+        SPEKTRUM_PROFILE_START(parseStart);
+        decodeFrame((Data*)inData, now);
+        SPEKTRUM_PROFILE_END(StageParseFrame, parseStart);
         // check if the frame is valid
         result = isValidSystem(this->system);
         status = Receiving;
+        this->setFailsafeActive(false);
 
         // log the status
         logFrame(available, result);
+        if (result) this->notifyFrame(*this);
       } else {
         log("Frame ignored because of timeout");
       }
     }
+  } else if ((Options & (SpektrumWithFailsafe | SpektrumWithCallbacks)) &&
+             status == Receiving && isLinkStale()) {
+    log("Connection lost");
+    status = NotConnected;
+    this->beginUpdate();
+    this->applyFailsafe(channelValues);
+    this->endUpdate();
+    this->notifyConnectionLost(*this);
   }
 
   return result;
 }
 
-template <class T>
-T SpektrumSatellite<T>::getThrottle() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getThrottle() {
   return getChannelValue(Throttle);
 }
 
-template <class T>
-T SpektrumSatellite<T>::getAileron() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getAileron() {
   return getChannelValue(Aileron);
 }
 
-template <class T>
-T SpektrumSatellite<T>::getElevator() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getElevator() {
   return getChannelValue(Elevator);
 }
 
-template <class T>
-T SpektrumSatellite<T>::getRudder() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getRudder() {
   return getChannelValue(Rudder);
 }
 
-template <class T>
-T SpektrumSatellite<T>::getGear() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getGear() {
   return getChannelValue(Gear);
 }
 
-template <class T>
-T SpektrumSatellite<T>::getAux1() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getAux1() {
   return getChannelValue(Aux1);
 }
 
-template <class T>
-T SpektrumSatellite<T>::getAux2() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getAux2() {
   return getChannelValue(Aux2);
 }
 
-template <class T>
-T SpektrumSatellite<T>::getAux3() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getAux3() {
   return getChannelValue(Aux3);
 }
 
-template <class T>
-T SpektrumSatellite<T>::getAux4() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getAux4() {
   return getChannelValue(Aux4);
 }
 
-template <class T>
-T SpektrumSatellite<T>::getAux5() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getAux5() {
   return getChannelValue(Aux5);
 }
 
-template <class T>
-T SpektrumSatellite<T>::getAux6() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getAux6() {
   return getChannelValue(Aux6);
 }
 
-template <class T>
-T SpektrumSatellite<T>::getAux7() {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getAux7() {
   return getChannelValue(Aux7);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setChannelValue(Channel channelId, T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setChannelValue(Channel channelId,
+                                                    T value) {
+  setChannelValueRaw(channelId, this->deScaleValue(value));
+}
+
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setChannelValueRaw(Channel channelId,
+                                                       uint16_t value) {
   if (channelId >= Throttle && channelId <= Aux7) {
-    channelValues[channelId] = scaler.deScale(value);
+    this->beginUpdate();
+    channelValues[channelId] = value;
+    this->endUpdate();
     if (channelId >= Aux1) {
-      isSendAuxData = true;
+      this->setSendAuxData(true);
     }
   } else {
     log("Invalid Channel Number:", static_cast<int>(channelId));
   }
 }
 
-template <class T>
-T SpektrumSatellite<T>::getChannelValue(Channel channelId) {
+template <class T, int Options>
+T SpektrumSatellite<T, Options>::getChannelValue(Channel channelId) {
   if (channelId >= Throttle && channelId <= Aux7) {
-    return scaler.scale(channelValues[channelId]);
+    SPEKTRUM_PROFILE_START(scaleStart);
+    T result = this->scaleValue(channelValues[channelId]);
+    SPEKTRUM_PROFILE_END(StageScale, scaleStart);
+    return result;
   } else {
     log("Invalid Channel Number:", static_cast<int>(channelId));
     return 0;
   }
 }
 
-template <class T>
-const char* SpektrumSatellite<T>::getChannelName(Channel channelId) {
+template <class T, int Options>
+const char* SpektrumSatellite<T, Options>::getChannelName(Channel channelId) {
   return ChannelNames[channelId];
 }
 
-template <class T>
-void SpektrumSatellite<T>::setThrottle(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setThrottle(T value) {
   setChannelValue(Throttle, value);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setAileron(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setAileron(T value) {
   setChannelValue(Aileron, value);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setElevator(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setElevator(T value) {
   setChannelValue(Elevator, value);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setRudder(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setRudder(T value) {
   setChannelValue(Rudder, value);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setGear(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setGear(T value) {
   setChannelValue(Gear, value);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setAux1(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setAux1(T value) {
   setChannelValue(Aux1, value);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setAux2(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setAux2(T value) {
   setChannelValue(Aux2, value);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setAux3(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setAux3(T value) {
   setChannelValue(Aux3, value);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setAux4(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setAux4(T value) {
   setChannelValue(Aux4, value);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setAux5(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setAux5(T value) {
   setChannelValue(Aux5, value);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setAux6(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setAux6(T value) {
   setChannelValue(Aux6, value);
 }
 
-template <class T>
-void SpektrumSatellite<T>::setAux7(T value) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setAux7(T value) {
   setChannelValue(Aux7, value);
 }
 
-template <class T>
-Data* SpektrumSatellite<T>::getSendBuffer() {
+template <class T, int Options>
+Data* SpektrumSatellite<T, Options>::getSendBuffer() {
   return getSendBuffer(false);
 }
 
-template <class T>
-Data* SpektrumSatellite<T>::getSendBuffer(boolean auxData) {
+template <class T, int Options>
+Data* SpektrumSatellite<T, Options>::getSendBuffer(boolean auxData) {
   // Clear only the values array and header
-  for (int i = 0; i < 7; ++i) dataPacket.values[i] = 0;
-  dataPacket.header.fades = 0;
+  for (int i = 0; i < 7; ++i) this->dataPacket.values[i] = 0;
+  this->dataPacket.header.fades = 0;
 
   // determine the position of the index info
   uint16_t channelShift = is2048() ? 11 : 10;
   if (auxData) {
-    // Fill values[0..5] with Aux1..Aux6 (j=6..11), values[6] with Aux7 (j=12,
-    // if present)
-    for (int j = 6; j < MAX_CHANNELS && (j - 6) < 7; ++j) {
-      dataPacket.values[j - 6] =
-          (channelValues[j] & maskVALUE) | (j << channelShift);
-      swapBytes(&dataPacket.values[j - 6]);
+    // Fill values[0..5] with Aux2..Aux7 (j=6..11)
+    for (int j = 6; j < MAX_CHANNELS; ++j) {
+      uint16_t value = channelValues[this->mapChannel(j)] & maskVALUE;
+      this->dataPacket.values[j - 6] =
+          this->mapValue(j, value, maskVALUE) | (j << channelShift);
+      swapBytes(&this->dataPacket.values[j - 6]);
     }
   } else {
     // Fill values[0..6] with Throttle..Aux6 (j=0..6)
     for (int j = 0; j < 7; ++j) {
-      dataPacket.values[j] =
-          (channelValues[j] & maskVALUE) | (j << channelShift);
-      swapBytes(&dataPacket.values[j]);
+      uint16_t value = channelValues[this->mapChannel(j)] & maskVALUE;
+      this->dataPacket.values[j] =
+          this->mapValue(j, value, maskVALUE) | (j << channelShift);
+      swapBytes(&this->dataPacket.values[j]);
     }
   }
 
   // if the mode is internal we need to add the system id
-  Header* header = &(dataPacket.header);
+  Header* header = &(this->dataPacket.header);
   if (isInternal()) {
     header->internal.fades = this->fades;
     header->internal.system = this->system;
@@ -620,194 +1320,380 @@ Data* SpektrumSatellite<T>::getSendBuffer(boolean auxData) {
     header->fades = this->fades;
   }
 
-  return &dataPacket;
+  return &this->dataPacket;
 }
 
-template <class T>
-void SpektrumSatellite<T>::sendData() {
-  if (sendCount > 0 && sendCount++ % logMod == 0) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::sendData() {
+  this->countSend();
+  if (isLogDue(this->getSendCount() - 1)) {
     log("sendData");
   }
+  SPEKTRUM_PROFILE_START(bufferStart);
   Data* data = getSendBuffer();
+  SPEKTRUM_PROFILE_END(StageSendBuffer, bufferStart);
+  SPEKTRUM_PROFILE_START(writeStart);
   serial->write((byte*)data, SEND_BUFFER_SIZE);
+  SPEKTRUM_PROFILE_END(StageWrite, writeStart);
 
   // send Aux if necessary
-  if (isSendAuxData) {
+  if (this->isSendAuxData) {
+    SPEKTRUM_PROFILE_START(auxBufferStart);
     Data* data = getSendBuffer(true);
+    SPEKTRUM_PROFILE_END(StageSendBuffer, auxBufferStart);
+    SPEKTRUM_PROFILE_START(auxWriteStart);
     serial->write((byte*)data, SEND_BUFFER_SIZE);
+    SPEKTRUM_PROFILE_END(StageWrite, auxWriteStart);
   }
 }
 
-template <class T>
-void SpektrumSatellite<T>::sendData(uint8_t* str) {
-  if (logMod > 0 && sendCount++ % logMod == 0) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::sendData(uint8_t* str) {
+  this->countSend();
+  if (isLogDue(this->getSendCount() - 1)) {
     log((char*)str);
   }
   serial->print((char*)str);
   serial->flush();
 }
 
-template <class T>
-bool SpektrumSatellite<T>::isConnected() {
+template <class T, int Options>
+bool SpektrumSatellite<T, Options>::isConnected() {
   return isConnected(TRANSACTION_TIME);
 }
 
-template <class T>
-bool SpektrumSatellite<T>::isConnected(long transactionTime) {
-  return (millis() - timeOfLastRead < transactionTime);
+template <class T, int Options>
+bool SpektrumSatellite<T, Options>::isLinkStale() {
+  return millis() - this->timeOfLastRead >
+         (unsigned long)this->getFailsafeFrames() * getFramePeriod();
 }
 
-template <class T>
-void SpektrumSatellite<T>::waitForData() {
+template <class T, int Options>
+bool SpektrumSatellite<T, Options>::isConnected(long transactionTime) {
+  return (millis() - this->timeOfLastRead < (unsigned long)transactionTime);
+}
+
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::waitForData() {
   log("waitForData");
+  // check often but log only once per second
+  int count = 0;
   while (!serial->available()) {
-    log1(".");
-    delay(1000);
+    if (++count % (1000 / WAIT_FOR_DATA_POLL_MS) == 0) log1(".");
+    delay(WAIT_FOR_DATA_POLL_MS);
   }
 }
 
-template <class T>
-void SpektrumSatellite<T>::setChannelValueRange(T min, T max) {
-  log("setChannelValueRange");
-  // set ouput value range
-  scaler.setActive(true);
-  T inMax = is2048() ? 2048 : 1024;
-  scaler.setValues(0, inMax, min, max);
-  log("setChannelValueRange <-");
+template <class T, int Options>
+unsigned SpektrumSatellite<T, Options>::getFramePeriod() {
+  unsigned systemPeriod =
+      (system == DSM2_22MS_1024 || system == DSMS_22MS_2048) ? 22 : 11;
+  // a slow loop can only process the frames in a longer interval
+  unsigned measured = this->getMeasuredFramePeriod();
+  return measured > systemPeriod ? measured : systemPeriod;
 }
 
-template <class T>
-bool SpektrumSatellite<T>::is2048() {
-  return this->system == DSM2_22MS_1024 ? false : true;
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setFailsafeFrames(uint8_t frames) {
+  static_assert(Options & SpektrumWithFailsafe, "needs SpektrumWithFailsafe");
+  // with 0 every poll without data would trigger the failsafe
+  this->failsafeFrames = frames > 0 ? frames : 1;
 }
 
-template <class T>
-uint16_t SpektrumSatellite<T>::getFades() {
-  return this->fades;
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setFailsafeValue(Channel channelId,
+                                                     T value) {
+  static_assert(Options & SpektrumWithFailsafe, "needs SpektrumWithFailsafe");
+  if (channelId >= Throttle && channelId <= Aux7) {
+    this->failsafeValues[channelId] = this->deScaleValue(value);
+    this->failsafePresetMask |= (1 << channelId);
+  } else {
+    log("Invalid Channel Number:", static_cast<int>(channelId));
+  }
 }
 
-template <class T>
-Scaler<T>* SpektrumSatellite<T>::getScaler() {
-  return &this.scaler;
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setFailsafeHold(Channel channelId) {
+  static_assert(Options & SpektrumWithFailsafe, "needs SpektrumWithFailsafe");
+  this->failsafePresetMask &= ~(1 << channelId);
 }
 
-template <class T>
-void SpektrumSatellite<T>::log(const char* str) {
-  if (serialLog == NULL) return;
-  serialLog->println(str);
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::onFrame(FrameCallback callback, void* ref) {
+  static_assert(Options & SpektrumWithCallbacks, "needs SpektrumWithCallbacks");
+  this->frameCallback = callback;
+  this->frameCallbackRef = ref;
 }
 
-template <class T>
-void SpektrumSatellite<T>::log(const char* str, const char* str1) {
-  if (serialLog == NULL) return;
-  serialLog->print(str);
-  serialLog->print(" ");
-  serialLog->println(str1);
+template <class T, int Options>
+template <class F>
+void SpektrumSatellite<T, Options>::onFrame(F& callable) {
+  onFrame(invokeFrameCallable<F>, &callable);
 }
 
-template <class T>
-void SpektrumSatellite<T>::log1(const char* str) {
-  if (serialLog == NULL) return;
-  serialLog->print(" ");
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::onConnectionLost(FrameCallback callback,
+                                            void* ref) {
+  static_assert(Options & SpektrumWithCallbacks, "needs SpektrumWithCallbacks");
+  this->connectionLostCallback = callback;
+  this->connectionLostCallbackRef = ref;
 }
 
-template <class T>
-void SpektrumSatellite<T>::log(const char* str, int value) {
-  if (serialLog == NULL) return;
-  serialLog->print(str);
-  serialLog->print(" ");
-  serialLog->println(value);
+template <class T, int Options>
+template <class F>
+void SpektrumSatellite<T, Options>::onConnectionLost(F& callable) {
+  onConnectionLost(invokeFrameCallable<F>, &callable);
 }
 
-template <class T>
-void SpektrumSatellite<T>::logHex(const char* str, int value) {
-  if (serialLog == NULL) return;
-  serialLog->print(str);
-  serialLog->print(" ");
-  serialLog->println(value, HEX);
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::onSystemDetected(SystemCallback callback,
+                                            void* ref) {
+  static_assert(Options & SpektrumWithCallbacks, "needs SpektrumWithCallbacks");
+  this->systemCallback = callback;
+  this->systemCallbackRef = ref;
 }
 
-template <class T>
-void SpektrumSatellite<T>::setLogMod(long value) {
-  this->logMod = value;
+template <class T, int Options>
+template <class F>
+void SpektrumSatellite<T, Options>::onSystemDetected(F& callable) {
+  onSystemDetected(invokeSystemCallable<F>, &callable);
 }
 
-template <class T>
-void SpektrumSatellite<T>::logFrame(long available, bool result) {
-  if (result) {
-    successCount++;
-  } else {
-    failCount++;
-  }
-  if (logMod > 0) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setChannelValueRange(T min, T max) {
+  log("setChannelValueRange");
+  // set ouput value range
+  T inMax = is2048() ? 2048 : 1024;
+  this->setScalerRange(inMax, min, max);
+  log("setChannelValueRange <-");
+}
+
+template <class T, int Options>
+bool SpektrumSatellite<T, Options>::is2048() {
+  return this->system == DSM2_22MS_1024 ? false : true;
+}
+
+template <class T, int Options>
+uint16_t SpektrumSatellite<T, Options>::getFades() {
+  return this->fades;
+}
+
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::logFrame(long available, bool result) {
+  this->countFrame(result);
+  if (getLogMod() > 0) {
     if (getStatus() == Receiving) {
-      if (frameCount % logMod == 0) {
+      if (isLogDue(this->getFrameCount() - 1)) {
         log("getFrame");
         log("available data:", available);
         log("-> isConnected:", isConnected() ? "true" : "false");
         log("-> isValidSystem:",
             isValidSystem(this->system) ? "true" : "false");
-        log("-> frameCount:", frameCount);
-        log("-> successCount:", successCount);
-        log("-> failCount:", failCount);
+        log("-> frameCount:", this->getFrameCount() - 1);
+        log("-> successCount:", this->getSuccessCount());
+        log("-> failCount:", this->getFailCount());
       }
     } else {
-      if (serialLog != NULL) {
-        serialLog->print(available > 0 ? "+" : ".");
+      if (this->getLog() != NULL) {
+        this->getLog()->print(available > 0 ? "+" : ".");
       }
     }
   }
-  frameCount++;
 }
 
-template <class T>
-void SpektrumSatellite<T>::setLog(Stream& logSer) {
-  this->serialLog = &logSer;
+template <class T, int Options>
+bool SpektrumSatellite<T, Options>::isLogDue(unsigned long count) {
+  // without counters we can not determine when to log
+  return !(Options & SpektrumNoStats) && getLogMod() > 0 &&
+         count % getLogMod() == 0;
 }
 
-template <class T>
-uint16_t* SpektrumSatellite<T>::getChannelValuesRaw() {
+template <class T, int Options>
+uint16_t* SpektrumSatellite<T, Options>::getChannelValuesRaw() {
   return channelValues;
 }
 
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::readSnapshot(SpektrumSnapshot& snapshot) {
+  const volatile uint16_t* values = channelValues;
+  unsigned start;
+  do {
+    // retry if the data was updated while we were copying it
+    start = this->getSequence();
+    SPEKTRUM_ACQUIRE_BARRIER();
+    for (int j = 0; j < MAX_CHANNELS; j++) {
+      snapshot.channelValues[j] = values[j];
+    }
+    snapshot.fades = *(const volatile uint16_t*)&fades;
+    snapshot.system = *(const volatile System*)&system;
+    // without the sequence we only know when the last frame was read
+    snapshot.timestamp = Options & SpektrumWithSnapshot
+                             ? this->getUpdateTime()
+                             : this->timeOfLastRead;
+    SPEKTRUM_ACQUIRE_BARRIER();
+  } while ((start & 1) || start != this->getSequence());
+}
+
+#ifdef SPEKTRUM_PROFILE
+template <class T, int Options>
+SpektrumProfiler* SpektrumSatellite<T, Options>::getProfiler() {
+  return &profiler;
+}
+#endif
+
 /**
  * The Spektrum Satellite power pin i using 3.3VDC +/-5%, 20mA max. However for
  * the ESP8266 The maximum current that can be drawn from a single GPIO pin is
  * 12mA.
  */
-template <class T>
-void SpektrumSatellite<T>::startBinding(unsigned powerPin, unsigned rxPin) {
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::startBinding(unsigned powerPin,
+                                                 unsigned rxPin) {
+  beginBinding(powerPin, rxPin);
+  while (!pollBinding()) {
+    delay(1);
+  }
+}
+
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::beginBinding(unsigned powerPin,
+                                                 unsigned rxPin) {
   // switch off serial interface
   if (serial) {
     log("startBinding");
+    this->bindingPowerPin = powerPin;
+    this->bindingRxPin = rxPin;
+
+    pinMode(rxPin, OUTPUT);            // sets the digital pin as output
+    pinMode(powerPin, OUTPUT);         // sets the digital pin as output
+    writeBindingPin(powerPin, false);  // make sure that the pin off
+    writeBindingPin(rxPin, true);      // set initial state to high
+
+    status = Binding;
+    this->bindingState = BindingPowerOff;
+    this->bindingRetries = 0;
+    this->bindingStartUs = getBindingMicros();
+    this->bindingStepStartUs = this->bindingStartUs;
+  }
+}
+
+template <class T, int Options>
+bool SpektrumSatellite<T, Options>::pollBinding() {
+  unsigned long now = getBindingMicros();
+  unsigned long elapsed = now - this->bindingStepStartUs;
+  switch (this->bindingState) {
+    case BindingPowerOff:
+      if (elapsed >= BINDING_POWER_OFF_MS * 1000UL) {
+        writeBindingPin(this->bindingPowerPin, true);
+        this->bindingState = BindingPowerOn;
+        this->bindingStepStartUs = now;
+      }
+      break;
+
+    case BindingPowerOn:
+      if (elapsed < BINDING_POWER_ON_MS * 1000UL) break;
+      // To put a receiver into bind mode, within 200ms of power application
+      // the host device needs to issue a series of falling pulses: so we
+      // send them in this call
+      log("-> number of pulses: ", bindMode);
+      this->bindingState = BindingPulses;
+      // fall through
+
+    case BindingPulses:
+      if (elapsed > BINDING_WINDOW_MS * 1000UL) {
+        retryBinding(now);
+      } else {
+        sendBindingPulses();
+      }
+      break;
 
-    pinMode(rxPin, OUTPUT);       // sets the digital pin as output
-    digitalWrite(rxPin, LOW);     // make sure that the pin off
-    pinMode(powerPin, OUTPUT);    // sets the digital pin as output
-    digitalWrite(powerPin, LOW);  // make sure that the pin off
-    digitalWrite(rxPin, HIGH);    // set initial state to high
-    delay(2000);
-
-    // To put a receiver into bind mode, within 200ms of power application the
-    // host device needs to issue a series of falling pulses
-    pinMode(powerPin, OUTPUT);     // sets the digital pin as output
-    digitalWrite(powerPin, HIGH);  // make sure that the pin off
-    delay(50);
-
-    log("-> number of pulses: ", bindMode);
-    // noInterrupts();
-
-    for (int j = 0; j < bindMode; j++) {
-      digitalWrite(rxPin, HIGH);                  // sets the digital pin on
-      delayMicroseconds(BINDING_PULSE_DELAY_MS);  // waits
-      digitalWrite(rxPin, LOW);                   // sets the digital pin  off
-      delayMicroseconds(BINDING_PULSE_DELAY_MS);  // waits
+    case BindingSettle:
+      if (elapsed >= BINDING_SETTLE_MS * 1000UL) {
+        pinMode(this->bindingRxPin, INPUT);
+        this->bindingState = BindingDone;
+        status = NotConnected;
+      }
+      break;
+
+    default:
+      break;
+  }
+  return this->bindingState == BindingDone ||
+         this->bindingState == BindingFailed ||
+         this->bindingState == BindingIdle;
+}
+
+// Sends all pulses in one burst (at most 2ms): the width of the pulses must
+// not depend on how often pollBinding() is called. Falling edges are even,
+// rising edges odd: each edge is due BINDING_PULSE_US after the previous one.
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::sendBindingPulses() {
+  unsigned long start = getBindingMicros();
+  for (unsigned long edge = 0; edge < 2UL * bindMode; edge++) {
+    while (edge > 0 && getBindingMicros() - start < edge * BINDING_PULSE_US) {
     }
-    // digitalWrite(rxPin, HIGH); // sets the digital pin on
-    // interrupts();
-    log("-> number of pulses DONE");
+    writeBindingPin(this->bindingRxPin, edge % 2 == 1);
+  }
+  log("-> number of pulses DONE");
+  this->bindingState = BindingSettle;
+  this->bindingStepStartUs = getBindingMicros();
+}
+
+// We missed the 200ms window after the power on: we power cycle the receiver
+// and try again
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::retryBinding(unsigned long now) {
+  if (++this->bindingRetries > BINDING_MAX_RETRIES) {
+    log("-> binding failed");
+    pinMode(this->bindingRxPin, INPUT);
+    this->bindingState = BindingFailed;
+    status = NotConnected;
+    return;
+  }
+  log("-> binding retry: ", this->bindingRetries);
+  writeBindingPin(this->bindingPowerPin, false);
+  writeBindingPin(this->bindingRxPin, true);
+  this->bindingState = BindingPowerOff;
+  this->bindingStartUs = now;
+  this->bindingStepStartUs = now;
+}
+
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::setBindingIO(BindingClock clock,
+                                                 BindingPinWrite pinWrite,
+                                                 void* ref) {
+  this->bindingClock = clock;
+  this->bindingPinWrite = pinWrite;
+  this->bindingPinWriteRef = ref;
+}
+
+template <class T, int Options>
+unsigned long SpektrumSatellite<T, Options>::getBindingMicros() {
+  return this->bindingClock != NULL ? this->bindingClock() : micros();
+}
+
+template <class T, int Options>
+void SpektrumSatellite<T, Options>::writeBindingPin(unsigned pin, bool high) {
+  if (this->bindingPinWrite != NULL) {
+    this->bindingPinWrite(pin, high, this->bindingPinWriteRef);
+  } else {
+    digitalWrite(pin, high ? HIGH : LOW);
+  }
+}
+
+template <class T, int Options>
+BindingState SpektrumSatellite<T, Options>::getBindingState() {
+  return this->bindingState;
+}
 
-    delay(500);
-    pinMode(rxPin, INPUT);  // sets the digital pin 13 as input
+template <class T, int Options>
+int SpektrumSatellite<T, Options>::getBindingProgress() {
+  if (this->bindingState == BindingIdle || this->bindingState == BindingDone ||
+      this->bindingState == BindingFailed) {
+    return 100;
   }
+  const unsigned long total =
+      BINDING_POWER_OFF_MS + BINDING_POWER_ON_MS + BINDING_SETTLE_MS;
+  unsigned long elapsed = (getBindingMicros() - this->bindingStartUs) / 1000;
+  return elapsed >= total ? 99 : elapsed * 100 / total;
 }
@@ -0,0 +1,286 @@
+/**
+ * Publishes the decoded frames of a SpektrumSatellite into a POSIX shared
+ * memory ring, so that several local processes (e.g. a logger, a telemetry
+ * exporter and a simulator bridge on a Linux gateway) can read the data
+ * without any serialization and without a system call per frame.
+ *
+ * The ring contains the last capacity frames. Each frame gets a generation
+ * number (starting at 1) and each slot is protected by its own sequence
+ * counter (seqlock): the publisher never waits for the readers and a reader
+ * detects when a slot has been overwritten while it was copying it.
+ *
+ * This is only available on systems which provide <sys/mman.h> (e.g. Linux
+ * or macOS): link with -lrt on older Linux versions.
+ * @author Phil Schatzmann
+ */
+
+#pragma once
+
+#if (defined(__unix__) || defined(__APPLE__)) && defined(__has_include)
+#if __has_include(<sys/mman.h>) && __has_include(<fcntl.h>)
+#define SPEKTRUM_SHARED_MEMORY
+#endif
+#endif
+
+#ifdef SPEKTRUM_SHARED_MEMORY
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "SpektrumSatellite.h"
+
+#define SPEKTRUM_SHM_NAME "/spektrum"
+#define SPEKTRUM_SHM_CAPACITY 256
+#define SPEKTRUM_SHM_MAGIC 0x544b5053
+#define SPEKTRUM_SHM_VERSION 1
+
+// A published frame
+struct SpektrumSharedFrame {
+  uint64_t generation;
+  // millis() of the publisher
+  uint32_t timestamp;
+  uint16_t channelValues[MAX_CHANNELS];
+  uint16_t fades;
+  uint8_t system;
+  uint8_t failsafe;
+};
+
+// Slot of the ring: the sequence is 2 * generation - 1 while it is written
+// and 2 * generation when it is complete
+struct SpektrumSharedSlot {
+  uint64_t sequence;
+  SpektrumSharedFrame frame;
+};
+
+// Start of the shared memory which is followed by the capacity slots
+struct SpektrumSharedHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;
+  uint32_t frameSize;
+  // generation of the last complete frame
+  uint64_t generation;
+};
+
+/**
+ * @brief Common logic of the SpektrumSharedMemoryPublisher and
+ * SpektrumSharedMemoryReader
+ * @author Phil Schatzmann
+ */
+class SpektrumSharedMemory {
+ public:
+  ~SpektrumSharedMemory() { end(); }
+
+  // Unmaps the shared memory
+  void end() {
+    if (header != NULL) {
+      munmap(header, mappedSize);
+      header = NULL;
+      slots = NULL;
+    }
+  }
+
+  // Number of frames which are kept in the ring
+  uint32_t getCapacity() { return header != NULL ? header->capacity : 0; }
+
+  // Generation of the last published frame (0 if there is none)
+  uint64_t getGeneration() {
+    return header != NULL
+               ? __atomic_load_n(&header->generation, __ATOMIC_ACQUIRE)
+               : 0;
+  }
+
+  // Oldest generation which is still available in the ring
+  uint64_t getOldestGeneration() {
+    uint64_t generation = getGeneration();
+    uint32_t capacity = getCapacity();
+    return generation > capacity ? generation - capacity + 1 : 1;
+  }
+
+  // Copies the indicated frame: returns false if it has not been published
+  // yet or if it has already been overwritten
+  bool read(uint64_t generation, SpektrumSharedFrame& frame) {
+    if (header == NULL || generation == 0) return false;
+    SpektrumSharedSlot* slot = slots + (generation % header->capacity);
+    uint64_t expected = 2 * generation;
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != expected) {
+      return false;
+    }
+    memcpy(&frame, &slot->frame, sizeof(frame));
+    SPEKTRUM_BARRIER();
+    return __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == expected;
+  }
+
+  // Copies the last published frame: returns false if there is none
+  bool readLatest(SpektrumSharedFrame& frame) {
+    uint64_t generation;
+    do {
+      // retry if the publisher has overtaken us
+      generation = getGeneration();
+      if (generation == 0) return false;
+    } while (!read(generation, frame));
+    return true;
+  }
+
+ protected:
+  const char* name;
+  SpektrumSharedHeader* header = NULL;
+  SpektrumSharedSlot* slots = NULL;
+  size_t mappedSize = 0;
+
+  SpektrumSharedMemory(const char* name) { this->name = name; }
+
+  static size_t sizeFor(uint32_t capacity) {
+    return sizeof(SpektrumSharedHeader) + capacity * sizeof(SpektrumSharedSlot);
+  }
+
+  // Checks that the mapped memory has been set up with the same layout
+  bool isCompatible() {
+    return __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) ==
+               SPEKTRUM_SHM_MAGIC &&
+           header->version == SPEKTRUM_SHM_VERSION &&
+           header->frameSize == sizeof(SpektrumSharedFrame) &&
+           header->capacity > 0 && sizeFor(header->capacity) <= mappedSize;
+  }
+
+  bool map(int fd, size_t size, int protection) {
+    void* memory = mmap(NULL, size, protection, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) return false;
+    header = (SpektrumSharedHeader*)memory;
+    slots = (SpektrumSharedSlot*)(header + 1);
+    mappedSize = size;
+    return true;
+  }
+};
+
+/**
+ * @brief Writes the frames of a SpektrumSatellite into the shared memory
+ * @author Phil Schatzmann
+ */
+class SpektrumSharedMemoryPublisher : public SpektrumSharedMemory {
+ public:
+  SpektrumSharedMemoryPublisher(const char* name = SPEKTRUM_SHM_NAME,
+                                uint32_t capacity = SPEKTRUM_SHM_CAPACITY)
+      : SpektrumSharedMemory(name) {
+    this->capacity = capacity > 0 ? capacity : 1;
+  }
+
+  // Creates the shared memory: an existing ring with the same layout (e.g.
+  // after a restart of the publisher) is reused, so that the attached readers
+  // keep the history and the generations continue. Any other existing memory
+  // is reinitialized.
+  bool begin() {
+    end();
+    size_t size = sizeFor(capacity);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    bool isNew = fd >= 0;
+    if (!isNew) fd = shm_open(name, O_RDWR, 0644);
+    if (fd < 0) return false;
+    if (!isNew && lseek(fd, 0, SEEK_END) == (off_t)size) {
+      if (!map(fd, size, PROT_READ | PROT_WRITE)) return false;
+      if (isCompatible()) return true;
+      end();
+      fd = shm_open(name, O_RDWR, 0644);
+      if (fd < 0) return false;
+    }
+    if (ftruncate(fd, size) != 0) {
+      close(fd);
+      return false;
+    }
+    if (!map(fd, size, PROT_READ | PROT_WRITE)) return false;
+    memset(header, 0, size);
+    header->version = SPEKTRUM_SHM_VERSION;
+    header->capacity = capacity;
+    header->frameSize = sizeof(SpektrumSharedFrame);
+    // readers only attach after the header is complete
+    __atomic_store_n(&header->magic, SPEKTRUM_SHM_MAGIC, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  // Creates the shared memory and publishes each frame which is decoded by
+  // getFrame(): this uses the onFrame() callback of the satellite (which needs
+  // SpektrumWithCallbacks). If you need the callback for something else, call
+  // publish() from it instead.
+  template <class T, int Options>
+  bool begin(SpektrumSatellite<T, Options>& satellite) {
+    if (!begin()) return false;
+    satellite.onFrame(publishFrame<T, Options>, this);
+    return true;
+  }
+
+  // Unmaps and removes the shared memory
+  void remove() {
+    end();
+    shm_unlink(name);
+  }
+
+  // Writes the current data of the satellite as next frame
+  template <class T, int Options>
+  void publish(SpektrumSatellite<T, Options>& satellite) {
+    SpektrumSnapshot snapshot;
+    satellite.readSnapshot(snapshot);
+    publish(snapshot, satellite.isFailsafe());
+  }
+
+  // Writes the snapshot as next frame
+  void publish(const SpektrumSnapshot& snapshot, bool failsafe = false) {
+    if (header == NULL) return;
+    uint64_t generation = header->generation + 1;
+    SpektrumSharedSlot* slot = slots + (generation % header->capacity);
+    __atomic_store_n(&slot->sequence, 2 * generation - 1, __ATOMIC_RELAXED);
+    SPEKTRUM_BARRIER();
+    SpektrumSharedFrame& frame = slot->frame;
+    frame.generation = generation;
+    frame.timestamp = snapshot.timestamp;
+    memcpy(frame.channelValues, snapshot.channelValues,
+           sizeof(frame.channelValues));
+    frame.fades = snapshot.fades;
+    frame.system = snapshot.system;
+    frame.failsafe = failsafe;
+    __atomic_store_n(&slot->sequence, 2 * generation, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->generation, generation, __ATOMIC_RELEASE);
+  }
+
+ protected:
+  uint32_t capacity;
+
+  template <class T, int Options>
+  static void publishFrame(SpektrumSatellite<T, Options>& satellite,
+                           void* ref) {
+    ((SpektrumSharedMemoryPublisher*)ref)->publish(satellite);
+  }
+};
+
+/**
+ * @brief Attaches to the shared memory of a SpektrumSharedMemoryPublisher
+ * (e.g. in another process)
+ * @author Phil Schatzmann
+ */
+class SpektrumSharedMemoryReader : public SpektrumSharedMemory {
+ public:
+  SpektrumSharedMemoryReader(const char* name = SPEKTRUM_SHM_NAME)
+      : SpektrumSharedMemory(name) {}
+
+  // Attaches to the shared memory: returns false if it does not exist (yet)
+  bool begin() {
+    end();
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return false;
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size < (off_t)sizeof(SpektrumSharedHeader)) {
+      close(fd);
+      return false;
+    }
+    if (!map(fd, size, PROT_READ)) return false;
+    // check that the publisher is compatible and has completed the setup
+    if (!isCompatible()) {
+      end();
+      return false;
+    }
+    return true;
+  }
+};
+
+#endif